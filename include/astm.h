@@ -23,7 +23,7 @@
 
     file        astm.h
 
-    date        05.05.2019
+    date        19.10.2026
 
     author      Uwe Jantzen (Klabautermann@Klabautermann-Software.de)
 
@@ -54,12 +54,17 @@ typedef struct dataset_t
     char flags[10];
     char UTID[12];                                                              // Universal Test ID
     char record_type;
+    long long time_key;                                                         // timestamp as the number YYYYMMDDhhmmss
     int record_number;
     } dataset;
 
+struct output_t;
+
 
 extern char read_astm( int handle );
 extern int data_transfer_mode( int handle, int contour_type );
+extern int replay_capture( const char * reports, size_t size, int contour_type, struct output_t * out );
+extern int decode_capture( const char * capture_name );
 
 
 #endif  // __ASTM_H__
@@ -0,0 +1,63 @@
+/*
+    Copyright (C)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+    See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.
+    If not, see <http://www.gnu.org/licenses/>.
+
+    Klabautermann Software
+    Uwe Jantzen
+    Weingartener Straße 33
+    76297 Stutensee
+    Germany
+
+    file        cfile.h
+
+    date        19.10.2026
+
+    author      Uwe Jantzen (jantzen@klabautermann-software.de)
+
+    brief       Transparently compressed files
+
+    details
+
+    project     glucotux
+    target      Linux
+    begin       03.03.2012
+
+    note
+
+    todo
+
+*/
+
+
+#ifndef __CFILE_H__
+#define __CFILE_H__
+
+
+#include <stdio.h>
+
+
+#define CFILE_PLAIN                         0
+#define CFILE_GZIP                          1
+#define CFILE_ZSTD                          2
+
+
+extern int cfile_kind_of_name( const char * name );
+extern int cfile_kind_of_file( const char * name );
+extern FILE * cfdopen( int fd, const char * mode, int kind );
+extern FILE * cfopen( const char * name, const char * mode );
+
+
+#endif  // __CFILE_H__
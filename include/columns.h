@@ -0,0 +1,111 @@
+/*
+    Copyright (C)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+    See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.
+    If not, see <http://www.gnu.org/licenses/>.
+
+    Klabautermann Software
+    Uwe Jantzen
+    Weingartener Straße 33
+    76297 Stutensee
+    Germany
+
+    file        columns.h
+
+    date        19.10.2026
+
+    author      Uwe Jantzen (jantzen@klabautermann-software.de)
+
+    brief       Records as columns
+
+    details     Every property of the records is an array of its own.
+                The strings are held as codes of a small dictionary.
+
+    project     glucotux
+    target      Linux
+    begin       03.03.2012
+
+    note
+
+    todo
+
+*/
+
+
+#ifndef __COLUMNS_H__
+#define __COLUMNS_H__
+
+
+#include <stddef.h>
+#include "astm.h"
+
+
+#define COLUMN_CODES                        256                                 // different strings per column
+#define COLUMN_NAME_LEN                     12                                  // longest string including '\0'
+
+enum                                                                            // codes every column store starts with
+    {
+    TYPE_GLUCOSE,
+    TYPE_INSULIN,
+    TYPE_CARB
+    };
+
+enum
+    {
+    UNIT_MG_DL,
+    UNIT_MMOL_L
+    };
+
+enum
+    {
+    FLAGS_NONE
+    };
+
+
+typedef struct dictionary_t
+    {
+    unsigned int count;
+    unsigned int last;                                                          // code found last, the next one is the same mostly
+    char names[COLUMN_CODES][COLUMN_NAME_LEN];
+    } dictionary;
+
+typedef struct columns_t
+    {
+    size_t count;                                                               // number of records
+    size_t capacity;                                                            // number of records space is allocated for
+    long long * time;                                                           // time keys YYYYMMDDhhmmss
+    unsigned char * digits;                                                     // number of digits of the timestamps
+    int * value;
+    int * number;                                                               // record numbers
+    unsigned char * type;                                                       // codes of types
+    unsigned char * unit;                                                       // codes of units
+    unsigned char * flags;                                                      // codes of flag strings
+    char * record_type;
+    dictionary types;
+    dictionary units;
+    dictionary flag_strings;
+    } columns;
+
+
+extern int dictionary_code( dictionary * d, const char * name, unsigned char * code );
+extern void dictionary_init( dictionary * d, const char * const * names, unsigned int count );
+extern int columns_init( columns * c, size_t capacity );
+extern void columns_free( columns * c );
+extern int columns_add( columns * c, const dataset * data );
+extern void columns_get( const columns * c, size_t i, dataset * data );
+extern int columns_from_datasets( columns * c, const dataset * data, size_t records );
+extern void columns_to_datasets( const columns * c, dataset * data );
+
+
+#endif  // __COLUMNS_H__
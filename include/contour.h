@@ -53,6 +53,27 @@
 #define TRANSFER_BUFFER_LEN                 64
 
 
+typedef struct contour_profile_t                                                // everything that differs between the models
+    {
+    unsigned short product_code;                                                // USB product id
+    const char * name;
+    int wait_for_enq;                                                           // meter sends ENQ before the transfer
+    unsigned int startup_delay_ms;                                              // wait time before the transfer starts
+    int header_product_field;                                                   // header : product^versions^serial
+    int header_count_field;                                                     // header : number of result records
+    int header_time_field;                                                      // header : time of the transfer
+    int record_number_field;                                                    // result : record number
+    int utid_field;                                                             // result : universal test id
+    int utid_skip;                                                              // result : leading "^^^" of the test id
+    int result_field;                                                           // result : value
+    int unit_field;                                                             // result : unit^reference
+    int flags_field;                                                            // result : markers separated by '/'
+    int timestamp_field;                                                        // result : time of the measurement
+    size_t timestamp_len;                                                       // YYYYMMDDhhmm or YYYYMMDDhhmmss
+    } contour_profile;
+
+
+extern const contour_profile * get_contour_profile( int contour_type );
 extern void close_contour( int handle );
 extern int wait_for_contour( int * contour_type, int * handle );
 extern int read_contour( int handle, char * buffer, size_t size, size_t * len );
@@ -0,0 +1,83 @@
+/*
+    Copyright (C)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+    See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.
+    If not, see <http://www.gnu.org/licenses/>.
+
+    Klabautermann Software
+    Uwe Jantzen
+    Weingartener Straße 33
+    76297 Stutensee
+    Germany
+
+    file        dedup.h
+
+    date        19.10.2026
+
+    author      Uwe Jantzen (jantzen@klabautermann-software.de)
+
+    brief       Set of records to find duplicates
+
+    details     Records are the same if their contents are the same, the record
+                numbers given by the meter don't count.
+
+    project     glucotux
+    target      Linux
+    begin       03.03.2012
+
+    note
+
+    todo
+
+*/
+
+
+#ifndef __DEDUP_H__
+#define __DEDUP_H__
+
+
+#include <stddef.h>
+#include "astm.h"
+#include "columns.h"
+
+
+typedef struct record_key_t                                                     // the contents of a record
+    {
+    long long time;                                                             // time key YYYYMMDDhhmmss
+    int value;
+    unsigned char type;                                                         // codes of the strings
+    unsigned char unit;
+    unsigned char flags;
+    unsigned char used;                                                         // FALSE for an empty slot
+    } record_key;
+
+typedef struct record_set_t
+    {
+    size_t slots;                                                               // a power of 2
+    size_t count;                                                               // number of records in the set
+    record_key * keys;
+    size_t * filled;                                                            // slots in use, at most slots / 2 + 1
+    dictionary types;
+    dictionary units;
+    dictionary flag_strings;
+    } record_set;
+
+
+extern int record_set_init( record_set * set, size_t records );
+extern void record_set_free( record_set * set );
+extern void record_set_clear( record_set * set );
+extern int record_set_add( record_set * set, const dataset * data, int * added );
+
+
+#endif  // __DEDUP_H__
@@ -23,7 +23,7 @@
 
     ERRORS      errors.h
 
-    date        10.11.2019
+    date        19.10.2026
 
     author      Uwe Jantzen (Klabautermann@Klabautermann-Software.de)
 
@@ -72,6 +72,24 @@
 #define ERR_NUM_OF_INFILES                          -19
 #define ERR_UNIT_STRING_TOO_LONG                    -20
 #define ERR_NO_INFILE                               -21
+#define ERR_CAPTURE_FORMAT                          -22
+#define ERR_END_OF_CAPTURE                          -23
+#define ERR_START_THREAD                            -24
+#define ERR_UNKNOWN_METER                           -25
+#define ERR_STORE                                   -26
+#define ERR_NO_SQLITE                               -27
+#define ERR_MAP_FILE                                -28
+#define ERR_TOO_MANY_CODES                          -29
+#define ERR_GTX_FORMAT                              -30
+#define ERR_GTX_ORDER                               -31
+#define ERR_MASTER_FORMAT                           -32
+#define ERR_DATE_FORMAT                             -33
+#define ERR_FILTER_FORMAT                           -34
+#define ERR_FILTERED                                -35
+#define ERR_PROGRESS_FD                             -36
+#define ERR_METER_NAME                              -37
+#define ERR_NOT_SORTED                              -38
+#define ERR_FILTER_INCREMENTAL                      -39
 
 
 extern void showerr( int error );
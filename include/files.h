@@ -46,8 +46,21 @@
 #define __FILES_H__
 
 
-extern int mixfiles( const char *infile_name, const char *infile_name2, const char *outfile_name );
+#include <stddef.h>
+#include "astm.h"
+#include "filter.h"
+
+
+typedef int (* line_parser)( dataset * data, const char * line, size_t len, const record_filter * filter );
+
+
+extern int parse_old( dataset * data, const char * line, size_t len, const record_filter * filter );
+extern int parse_current( dataset * data, const char * line, size_t len, const record_filter * filter );
+extern int mixfiles( const char *outfile_name );
 extern int csvformat( const char *infile_name, const char *outfile_name );
+extern int reformat( const char *infile_name, const char *outfile_name );
+extern int jsonformat( const char *infile_name, const char *outfile_name );
+extern int masterfiles( const char *master_name, const char *outfile_name );
 
 
 #endif  // __FILES_H__
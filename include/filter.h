@@ -0,0 +1,82 @@
+/*
+    Copyright (C)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+    See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.
+    If not, see <http://www.gnu.org/licenses/>.
+
+    Klabautermann Software
+    Uwe Jantzen
+    Weingartener Straße 33
+    76297 Stutensee
+    Germany
+
+    file        filter.h
+
+    date        19.10.2026
+
+    author      Uwe Jantzen (jantzen@klabautermann-software.de)
+
+    brief       Filters of the records read
+
+    details
+
+    project     glucotux
+    target      Linux
+    begin       03.03.2012
+
+    note
+
+    todo
+
+*/
+
+
+#ifndef __FILTER_H__
+#define __FILTER_H__
+
+
+#include <stddef.h>
+#include "astm.h"
+
+
+#define FILTER_GLUCOSE                      0x01
+#define FILTER_INSULIN                      0x02
+#define FILTER_CARB                         0x04
+#define FILTER_MARKERS_LEN                  8
+
+
+typedef struct record_filter_t                                                  // what a record must be to be taken
+    {
+    long long from;                                                             // time keys of the first and last record
+    long long until;
+    unsigned int types;                                                         // FILTER_..., 0 : all
+    char markers[FILTER_MARKERS_LEN];                                           // one of them is needed, "" : all
+    int min_value;
+    int max_value;
+    } record_filter;
+
+
+extern void filter_init( record_filter * f );
+extern int filter_is_set( const record_filter * f );
+extern int filter_set_types( record_filter * f, const char * names );
+extern int filter_set_markers( record_filter * f, const char * markers );
+extern int filter_set_values( record_filter * f, const char * range );
+extern int filter_time( const record_filter * f, long long key );
+extern int filter_type( const record_filter * f, char utid );
+extern int filter_markers( const record_filter * f, const char * flags, size_t len );
+extern int filter_value( const record_filter * f, int value );
+extern int filter_record( const record_filter * f, const dataset * data );
+
+
+#endif  // __FILTER_H__
@@ -0,0 +1,64 @@
+/*
+    Copyright (C)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+    See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.
+    If not, see <http://www.gnu.org/licenses/>.
+
+    Klabautermann Software
+    Uwe Jantzen
+    Weingartener Straße 33
+    76297 Stutensee
+    Germany
+
+    file        format.h
+
+    date        19.10.2026
+
+    author      Uwe Jantzen (jantzen@klabautermann-software.de)
+
+    brief       Formats records without allocating memory
+
+    details
+
+    project     glucotux
+    target      Linux
+    begin       03.03.2012
+
+    note
+
+    todo
+
+*/
+
+
+#ifndef __FORMAT_H__
+#define __FORMAT_H__
+
+
+#include "astm.h"
+
+
+#define FORMAT_LINE_LEN                     320                                 // longest line of any format including '\0'
+
+
+extern char * format_int( char * dst, int value );
+extern char * format_int_right( char * dst, int value, int width );
+extern char * format_str_left( char * dst, const char * src, int width );
+extern char * format_tenths( char * dst, int value, int width, char point );
+extern size_t format_line( const dataset * data, char * buffer );
+extern size_t format_csv( const dataset * data, char * buffer );
+extern size_t format_json( const dataset * data, char * buffer );
+
+
+#endif  // __FORMAT_H__
@@ -23,7 +23,7 @@
 
     file        globals.h
 
-    date        05.05.2019
+    date        19.10.2026
 
     author      Uwe Jantzen (Klabautermann@Klabautermann-Software.de)
 
@@ -62,6 +62,8 @@
 #define ETB                                 0x17
 
 
+struct record_filter_t;
+
 extern void init_globals( void );
 extern int is_verbose( void );
 extern void set_verbose( int flag );
@@ -69,6 +71,8 @@ extern void set_debug( int flag );
 extern int is_debug( void );
 extern void set_cvs_out( int flag );
 extern int is_cvs_out( void );
+extern void set_json_out( int flag );
+extern int is_json_out( void );
 extern void set_reformat( int flag );
 extern int is_reformat( void );
 extern int set_outfile_name( char * filename );
@@ -77,6 +81,36 @@ extern int set_infile_name( char * filename, int i );
 extern char const *  get_infile_name( int i );
 extern int set_infile_number( int i );
 extern int const get_infile_number( void );
+extern void set_benchmark( int flag );
+extern int is_benchmark( void );
+extern void set_progress_fd( int fd );
+extern int get_progress_fd( void );
+extern void set_sort_budget( int megabytes );
+extern int get_sort_budget( void );
+extern void set_range_from( long long key );
+extern long long get_range_from( void );
+extern void set_range_until( long long key );
+extern long long get_range_until( void );
+extern int is_range( void );
+extern int set_filter_types( const char * names );
+extern int set_filter_markers( const char * markers );
+extern int set_filter_values( const char * range );
+extern const struct record_filter_t * get_filter( void );
+extern int is_filter( void );
+extern void set_threads( int number );
+extern int get_threads( void );
+extern void set_incremental( int flag );
+extern int is_incremental( void );
+extern int set_capture_name( char * filename );
+extern char const *  get_capture_name( void );
+extern int set_replay_name( char * filename );
+extern char const *  get_replay_name( void );
+extern int set_store_name( char * filename );
+extern char const *  get_store_name( void );
+extern int set_meter_name( char * serial );
+extern char const *  get_meter_name( void );
+extern int set_master_name( char * filename );
+extern char const *  get_master_name( void );
 
 
 #endif  // __GLOBALS_H__
@@ -0,0 +1,149 @@
+/*
+    Copyright (C)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+    See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.
+    If not, see <http://www.gnu.org/licenses/>.
+
+    Klabautermann Software
+    Uwe Jantzen
+    Weingartener Straße 33
+    76297 Stutensee
+    Germany
+
+    file        gtx.h
+
+    date        19.10.2026
+
+    author      Uwe Jantzen (jantzen@klabautermann-software.de)
+
+    brief       Binary columnar record files (.gtx)
+
+    details     A .gtx file holds records sorted by time, in blocks of columns :
+
+                    header          gtx_header, 64 bytes
+                    block 0 ... n   columns of up to GTX_BLOCK_RECORDS records,
+                                    each column padded to 8 bytes :
+                                        uint32  time - block's first time key
+                                        int32   value
+                                        int32   record number
+                                        uint8   type code
+                                        uint8   unit code
+                                        uint8   flags code
+                                        char    record type
+                                        uint8   number of timestamp digits
+                    index           gtx_block_info per block
+                    dictionaries    strings of the type, unit and flags codes,
+                                    GTX_NAME_LEN chars each
+
+                All numbers are little endian. A reader maps the file and uses
+                the columns in place.
+
+    project     glucotux
+    target      Linux
+    begin       03.03.2012
+
+    note
+
+    todo
+
+*/
+
+
+#ifndef __GTX_H__
+#define __GTX_H__
+
+
+#include <stdio.h>
+#include <stdint.h>
+#include "astm.h"
+#include "columns.h"
+
+
+#define GTX_MAGIC                           "GTXCOLS"                           // 8 bytes including '\0'
+#define GTX_VERSION                         1
+#define GTX_BLOCK_RECORDS                   4096
+#define GTX_NAME_LEN                        COLUMN_NAME_LEN
+
+
+typedef struct gtx_header_t
+    {
+    char magic[8];
+    uint32_t version;
+    uint32_t block_records;                                                     // maximum number of records per block
+    uint64_t records;
+    uint64_t blocks;
+    uint64_t index_offset;                                                      // offset of the index, the dictionaries follow
+    uint32_t codes[3];                                                          // number of type, unit and flags codes
+    uint32_t reserved[3];
+    } gtx_header;
+
+typedef struct gtx_block_info_t
+    {
+    uint64_t offset;                                                            // offset of the block's first column
+    int64_t min_time;                                                           // time keys of the first and last record
+    int64_t max_time;
+    uint32_t count;                                                             // number of records
+    uint32_t reserved;
+    } gtx_block_info;
+
+typedef struct gtx_block_t                                                      // columns of a block, in place
+    {
+    long long base;                                                             // time key the times are relative to
+    size_t count;
+    const uint32_t * time;
+    const int32_t * value;
+    const int32_t * number;
+    const unsigned char * type;
+    const unsigned char * unit;
+    const unsigned char * flags;
+    const char * record_type;
+    const unsigned char * digits;
+    } gtx_block;
+
+typedef struct gtx_t                                                            // a .gtx file opened for reading
+    {
+    const char * map;
+    size_t size;
+    const gtx_header * header;
+    const gtx_block_info * blocks;
+    const char (* names[3])[GTX_NAME_LEN];                                      // dictionaries of types, units and flags
+    } gtx;
+
+typedef struct gtx_writer_t                                                     // a .gtx file being written
+    {
+    FILE * f;
+    columns block;                                                              // records of the block being filled
+    uint32_t * time;                                                            // the block's times written
+    gtx_block_info * index;
+    size_t blocks;
+    size_t index_capacity;
+    uint64_t records;
+    uint64_t offset;                                                            // where the next block starts
+    } gtx_writer;
+
+
+extern int gtx_is_name( const char * name );
+extern int gtx_is_file( const char * name );
+extern int gtx_open( gtx * g, const char * name );
+extern void gtx_close( gtx * g );
+extern size_t gtx_records( const gtx * g );
+extern void gtx_get_block( const gtx * g, size_t b, gtx_block * block );
+extern void gtx_get( const gtx * g, const gtx_block * block, size_t i, dataset * data );
+extern void gtx_find( const gtx * g, long long time, size_t * b, size_t * i );
+extern int gtx_create( gtx_writer * w, const char * name );
+extern int gtx_write( gtx_writer * w, const dataset * data );
+extern int gtx_finish( gtx_writer * w, int result );
+
+
+#endif  // __GTX_H__
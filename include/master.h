@@ -0,0 +1,82 @@
+/*
+    Copyright (C)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+    See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.
+    If not, see <http://www.gnu.org/licenses/>.
+
+    Klabautermann Software
+    Uwe Jantzen
+    Weingartener Straße 33
+    76297 Stutensee
+    Germany
+
+    file        master.h
+
+    date        19.10.2026
+
+    author      Uwe Jantzen (jantzen@klabautermann-software.de)
+
+    brief       Master history : append-only .gtx segments and a manifest
+
+    details
+
+    project     glucotux
+    target      Linux
+    begin       03.03.2012
+
+    note
+
+    todo
+
+*/
+
+
+#ifndef __MASTER_H__
+#define __MASTER_H__
+
+
+#include <sys/types.h>
+#include "astm.h"
+
+
+#define MASTER_MANIFEST                     "manifest"
+#define MASTER_SEGMENT_LEN                  32
+#define MASTER_PATH_LEN                     1024
+
+
+typedef struct master_segment_t                                                 // one line of the manifest
+    {
+    char name[MASTER_SEGMENT_LEN];                                              // file name in the master's directory
+    size_t records;
+    long long min_time;                                                         // time keys of the first and last record
+    long long max_time;
+    } master_segment;
+
+typedef struct master_t
+    {
+    char path[MASTER_PATH_LEN];                                                    // the master's directory
+    master_segment * segments;
+    size_t count;
+    size_t capacity;
+    off_t length;                                                               // bytes of the manifest's complete lines
+    } master;
+
+
+extern int master_open( master * m, const char * path );
+extern void master_close( master * m );
+extern int master_segment_path( const master * m, size_t s, char * path, size_t len );
+extern int master_append( master * m, const dataset * data, size_t records, size_t * added );
+
+
+#endif  // __MASTER_H__
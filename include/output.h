@@ -0,0 +1,82 @@
+/*
+    Copyright (C)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+    See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.
+    If not, see <http://www.gnu.org/licenses/>.
+
+    Klabautermann Software
+    Uwe Jantzen
+    Weingartener Straße 33
+    76297 Stutensee
+    Germany
+
+    file        output.h
+
+    date        19.10.2026
+
+    author      Uwe Jantzen (jantzen@klabautermann-software.de)
+
+    brief       Buffered output written by a background thread
+
+    details
+
+    project     glucotux
+    target      Linux
+    begin       03.03.2012
+
+    note
+
+    todo
+
+*/
+
+
+#ifndef __OUTPUT_H__
+#define __OUTPUT_H__
+
+
+#include <stdio.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "ring.h"
+
+
+#define OUTPUT_NAME_LEN                     1040
+
+#define OUTPUT_REPLACE                      0                                   // write a temporary file, rename it when closed
+#define OUTPUT_APPEND                       1                                   // append to the file
+#define OUTPUT_DIRECT                       2                                   // write to the file, e.g. stdout or /dev/null
+
+
+typedef struct output_t
+    {
+    int fd;
+    FILE * file;                                                                // compressing stream on fd, 0 if plain
+    int mode;
+    char name[OUTPUT_NAME_LEN];
+    char temp_name[OUTPUT_NAME_LEN];
+    ring buffers;                                                               // filled buffers waiting to be written
+    char * buffer;                                                              // buffer being filled, 0 if none
+    size_t fill;                                                                // number of bytes in buffer
+    pthread_t thread;
+    atomic_int result;                                                          // writer's error code
+    } output;
+
+
+extern int output_open( output * out, const char * filename, int mode );
+extern int output_write( output * out, const char * data, size_t length );
+extern int output_close( output * out, int commit );
+
+
+#endif  // __OUTPUT_H__
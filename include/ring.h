@@ -0,0 +1,80 @@
+/*
+    Copyright (C)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+    See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.
+    If not, see <http://www.gnu.org/licenses/>.
+
+    Klabautermann Software
+    Uwe Jantzen
+    Weingartener Straße 33
+    76297 Stutensee
+    Germany
+
+    file        ring.h
+
+    date        19.10.2026
+
+    author      Uwe Jantzen (jantzen@klabautermann-software.de)
+
+    brief       Single-producer / single-consumer ring of buffers
+
+    details
+
+    project     glucotux
+    target      Linux
+    begin       03.03.2012
+
+    note
+
+    todo
+
+*/
+
+
+#ifndef __RING_H__
+#define __RING_H__
+
+
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+
+typedef struct ring_t
+    {
+    size_t slots;                                                               // number of buffers, a power of 2
+    size_t slot_size;                                                           // bytes per buffer
+    char * buffers;
+    size_t * lengths;                                                           // number of bytes used per buffer
+    atomic_size_t head;                                                         // written by the producer only
+    atomic_size_t tail;                                                         // written by the consumer only
+    int closed;                                                                 // no more buffers will be put
+    pthread_mutex_t lock;                                                       // guards closed and the waits only
+    pthread_cond_t changed;                                                     // a buffer was put or released
+    } ring;
+
+
+extern int ring_init( ring * r, size_t slots, size_t slot_size );
+extern void ring_free( ring * r );
+extern char * ring_get_write( ring * r );
+extern void ring_put( ring * r, size_t length );
+extern char * ring_get_read( ring * r, size_t * length );
+extern void ring_release( ring * r );
+extern void ring_close( ring * r );
+extern char * ring_wait_write( ring * r );
+extern char * ring_wait_read( ring * r, size_t * length );
+extern void ring_wait_empty( ring * r );
+
+
+#endif  // __RING_H__
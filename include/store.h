@@ -0,0 +1,73 @@
+/*
+    Copyright (C)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+    See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.
+    If not, see <http://www.gnu.org/licenses/>.
+
+    Klabautermann Software
+    Uwe Jantzen
+    Weingartener Straße 33
+    76297 Stutensee
+    Germany
+
+    file        store.h
+
+    date        19.10.2026
+
+    author      Uwe Jantzen (jantzen@klabautermann-software.de)
+
+    brief       SQLite record store
+
+    details
+
+    project     glucotux
+    target      Linux
+    begin       03.03.2012
+
+    note
+
+    todo
+
+*/
+
+
+#ifndef __STORE_H__
+#define __STORE_H__
+
+
+#include "astm.h"
+
+
+#define STORE_METER_LEN                     32
+
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+typedef struct store_t
+    {
+    struct sqlite3 * db;
+    struct sqlite3_stmt * insert;                                               // prepared once, used for every record
+    int pending;                                                                // records in the open transaction
+    char meter[STORE_METER_LEN];                                                // serial number of the meter
+    } store;
+
+
+extern int store_open( store * st, const char * name );
+extern void store_set_meter( store * st, const char * meter );
+extern int store_add( store * st, const dataset * data );
+extern int store_close( store * st, int commit );
+
+
+#endif  // __STORE_H__
@@ -0,0 +1,82 @@
+/*
+    Copyright (C)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+    See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.
+    If not, see <http://www.gnu.org/licenses/>.
+
+    Klabautermann Software
+    Uwe Jantzen
+    Weingartener Straße 33
+    76297 Stutensee
+    Germany
+
+    file        timeindex.h
+
+    date        19.10.2026
+
+    author      Uwe Jantzen (jantzen@klabautermann-software.de)
+
+    brief       Sparse time index of a data file
+
+    details
+
+    project     glucotux
+    target      Linux
+    begin       03.03.2012
+
+    note
+
+    todo
+
+*/
+
+
+#ifndef __TIMEINDEX_H__
+#define __TIMEINDEX_H__
+
+
+#include <stdint.h>
+
+
+#define TIME_INDEX_SUFFIX                   ".tix"
+#define TIME_INDEX_MAGIC                    "GTXTIX1"
+
+
+typedef struct time_index_entry_t                                               // the first line of a day
+    {
+    int64_t day;                                                                // YYYYMMDD
+    uint64_t offset;
+    } time_index_entry;
+
+typedef struct time_index_t
+    {
+    uint64_t covered;                                                           // bytes of the data file indexed
+    uint64_t last_offset;                                                       // offset of the last line indexed
+    int64_t last_key;                                                           // time key of the last line indexed
+    int sorted;                                                                 // FALSE if a line is older than one before
+    size_t count;
+    size_t capacity;
+    time_index_entry * entries;
+    } time_index;
+
+
+extern void time_index_init( time_index * idx );
+extern void time_index_free( time_index * idx );
+extern int time_index_load( time_index * idx, const char * data_name );
+extern int time_index_save( const time_index * idx, const char * data_name );
+extern int time_index_add( time_index * idx, long long key, uint64_t offset );
+extern uint64_t time_index_find( const time_index * idx, long long from );
+
+
+#endif  // __TIMEINDEX_H__
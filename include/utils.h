@@ -23,7 +23,7 @@
 
     file        utils.h
 
-    date        23.11.2019
+    date        19.10.2026
 
     author      Uwe Jantzen (Klabautermann@Klabautermann-Software.de)
 
@@ -46,6 +46,7 @@
 #define __UTILS_H__
 
 
+#include <time.h>
 #include "astm.h"
 
 
@@ -59,7 +60,10 @@
 extern unsigned int explode( char * elements, char * str, char delimiter, size_t lines, size_t length );
 extern int printline( dataset * data, FILE * f );
 extern void time2ger( char * dst, char * src );
-extern void rotating_bar( void );
+extern long long timestamp_key( const char * timestamp );
+extern int date_key( const char * date, int until, long long * key );
+extern void key_timestamp( char * timestamp, long long key, int digits );
+extern double seconds_since( const struct timespec * start );
 extern void showhelp( char * name );
 extern void Showbuffer( const char * buffer, size_t size );
 
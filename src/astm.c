@@ -23,13 +23,34 @@
 
     file        astm.c
 
-    date        23.11.2019
+    date        19.10.2026
 
     author      Uwe Jantzen (Klabautermann@Klabautermann-Software.de)
 
     brief       Handle communication with countour device using ASTM specifications.
 
-    details
+    details     All reports read from the device may be saved to a raw
+                capture file. A raw capture is decoded offline by replaying
+                its reports through the same framing, checksum and record
+                interpretation code, without any device I/O or pacing sleeps.
+                In incremental mode a high-water mark (newest timestamp and
+                its record number) is kept per meter serial number. Only
+                records newer than the high-water mark are appended to the
+                output file, and the transfer ends as soon as the meter
+                sends records that were stored before.
+                Escape sequences (ASTM E-1394 7.4) are decoded by the field
+                tokenizer while it splits a record into its fields.
+                A transfer runs in two threads : the calling thread owns the
+                link to the device, it reads frames, checks them and
+                acknowledges them. The decoder thread interprets the frames
+                and writes the records. Frames are handed over through a
+                lock-free ring, so decoding and output never delay the
+                link's request-response cycle. Only in incremental mode the
+                reader waits for the decoder before it acknowledges the next
+                frame, so no frame is requested after the last new record.
+                The records are written through a buffered output stage and,
+                if a database is given (-q), to the record store.
+                Progress is reported by the progress module.
 
     project     glucotux
     target      Linux
@@ -46,13 +67,24 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <assert.h>
 #include "errors.h"
 #include "globals.h"
 #include "debug.h"
 #include "utils.h"
 #include "contour.h"
+#include "ring.h"
+#include "output.h"
+#include "progress.h"
+#include "format.h"
+#include "store.h"
 #include "astm.h"
+#include "filter.h"
 
 
 #define NUM_OF_FIELDS                       15
@@ -60,10 +92,51 @@
 #define NUM_OF_COMPONENTS                   11
 #define LEN_OF_COMPONENTS                   20
 #define FRAME_LEN                           (NUM_OF_FIELDS * LEN_OF_FIELDS)
+#define CAPTURE_MAGIC                       "GTXCAP"                            // raw capture header : "GTXCAP xxxx\n"
+#define CAPTURE_HEADER_LEN                  12                                  // xxxx : contour type in hex
+#define HWM_DIR                             ".glucotux"                         // high-water marks in $HOME/.glucotux/<serial>.hwm
+#define SERIAL_LEN                          LEN_OF_COMPONENTS
+#define TIMESTAMP_LEN                       15
+#define RAW_FIELD(n)                        (1u << (n))                         // field is split into components later
+#define RING_SLOTS                          64                                  // frames between reader and decoder
+
+
+typedef struct decoder_t
+    {
+    ring frames;                                                                // frames read, not yet decoded
+    output * out;
+    const contour_profile * profile;
+    atomic_int result;                                                          // decoder's error code
+    } decoder;
 
 
 // fielddelimiter: '|', repeat delimiter, component delimiter, escape delimiter
 static char delimiters[4] = { '|', 0, 0, 0 };
+static int frame_number = 1;
+
+static FILE * capture_file = 0;                                                 // raw capture written while reading
+static const char * replay_data = 0;                                            // raw capture replayed instead of reading
+static size_t replay_size = 0;
+static size_t replay_pos = 0;
+
+static char serial[SERIAL_LEN];                                                 // serial number of the meter
+static char hwm_timestamp[TIMESTAMP_LEN];                                       // newest record stored before, empty if none
+static int hwm_record_number = 0;
+static char newest_timestamp[TIMESTAMP_LEN];                                    // newest record of this transfer
+static int newest_record_number = 0;
+static char last_timestamp[TIMESTAMP_LEN];                                      // previous result record of this transfer
+static int last_record_number = 0;
+static int send_order = 0;                                                      // < 0 : newest first, > 0 : oldest first, 0 : not known
+static atomic_int end_of_new_records = FALSE;                                   // only records stored before will follow
+
+static char * new_lines = 0;                                                    // lines of the new records, appended at the end
+static size_t new_lines_len = 0;
+static size_t new_lines_size = 0;
+static size_t * new_line_ends = 0;                                              // end of each line in new_lines
+static size_t new_line_count = 0;
+static size_t new_line_capacity = 0;
+
+static store * record_store = 0;                                                // records are stored here too, 0 if not
 
 
 /*  function        static int _send_astm( int handle, const char *buffer, size_t size )
@@ -87,6 +160,9 @@ int _send_astm( int handle, const char *buffer, size_t size )
     if( size > TRANSFER_BUFFER_LEN-5 )
         return ERR_BUFFER_LEN;
 
+    if( replay_data )                                                           // nobody listens to a raw capture
+        return NOERR;
+
     usleep(30 * 1000);
 
     showbuffer(buffer, size);
@@ -103,6 +179,9 @@ int _send_astm( int handle, const char *buffer, size_t size )
 /*  function        static int _read( int handle, char * buffer, size_t * len )
 
     brief           Reads TRANSFER_BUFFER_LEN bytes from the contour device
+                    or, when replaying, the next report of the raw capture.
+                    Reports read from the device are saved to the raw capture
+                    file if one is open.
 
     param[in]       int handle, handle to the contour device
     param[out]      char * buffer, buffer to fill in the bytes read
@@ -117,10 +196,25 @@ static int _read( int handle, char * buffer, size_t * len )
     int result;
     assert(buffer);
 
-    memset(buffer, 0, TRANSFER_BUFFER_LEN);
-    result = read_contour(handle, buffer, TRANSFER_BUFFER_LEN, len);
-    if( result )
-        return result;
+    if( replay_data )
+        {
+        if( replay_pos + TRANSFER_BUFFER_LEN > replay_size )
+            return ERR_END_OF_CAPTURE;
+        memcpy(buffer, replay_data + replay_pos, TRANSFER_BUFFER_LEN);
+        replay_pos += TRANSFER_BUFFER_LEN;
+        }
+    else
+        {
+        memset(buffer, 0, TRANSFER_BUFFER_LEN);
+        result = read_contour(handle, buffer, TRANSFER_BUFFER_LEN, len);
+        if( result )
+            return result;
+        if( capture_file )
+            {
+            if( fwrite(buffer, TRANSFER_BUFFER_LEN, 1, capture_file) != 1 )
+                return ERR_WRITE_TO_FILE;
+            }
+        }
     for( i = 4, p = buffer + 4; i < TRANSFER_BUFFER_LEN; ++i )
         {
         if( *p++ == 0 )
@@ -129,7 +223,7 @@ static int _read( int handle, char * buffer, size_t * len )
     *len = i;
     showbuffer(buffer, *len);
 
-    return result;
+    return NOERR;                                                               // a replayed report never sets result
     }
 
 
@@ -152,7 +246,7 @@ static int _read_astm_part( int handle, char * buffer, size_t * len )
     int result;
     assert(buffer);
 
-    if( --num_of_calls_left == 0 )
+    if( ( --num_of_calls_left == 0 ) && ( replay_data == 0 ) )
         {
         usleep(20 * 1000);
         num_of_calls_left = 16;
@@ -296,37 +390,400 @@ char read_astm( int handle )
     }
 
 
-/*  function        static int _interpret_astm_frame( FILE * file, int handle, char * buffer, size_t length, int contour_type )
+/*  function        static void _get_hwm_name( char * name, size_t size )
 
-    brief           Interprets a frame read from a countour device. The frame
-                    given in buffer was verified for a correct transfer.
-                    If "file" is given stores the data to "file".
+    brief           Builds the name of the high-water mark file of the meter
+                    that is currently connected.
+
+    param[out]      char * name, the file's name
+    param[in]       size_t size, size of name
+*/
+static void _get_hwm_name( char * name, size_t size )
+    {
+    const char * home = getenv("HOME");
+
+    if( home == 0 )
+        home = ".";
+    snprintf(name, size, "%s/%s/%s.hwm", home, HWM_DIR, serial);
+    }
+
+
+/*  function        static void _load_hwm( void )
+
+    brief           Reads the high-water mark of the meter that is currently
+                    connected. If there is none, all records are new.
+*/
+static void _load_hwm( void )
+    {
+    char name[1024];
+    FILE * f;
+
+    *hwm_timestamp = 0;
+    hwm_record_number = 0;
+    _get_hwm_name(name, sizeof(name));
+    f = fopen(name, "r");
+    if( f == 0 )
+        return;
+    if( fscanf(f, "%14s %d", hwm_timestamp, &hwm_record_number) != 2 )
+        *hwm_timestamp = 0;
+    fclose(f);
+    debug("High-water mark of %s : %s %d\n", serial, hwm_timestamp, hwm_record_number);
+    }
+
+
+/*  function        static int _compare_mark( const char * timestamp, int record_number,
+                                          const char * mark_timestamp, int mark_record_number )
+
+    brief           Orders two records by their timestamp and, as the meter
+                    stores several records within the same minute, by their
+                    record number.
+
+    param[in]       const char * timestamp, record's timestamp
+    param[in]       int record_number, record's number
+    param[in]       const char * mark_timestamp, timestamp to compare with
+    param[in]       int mark_record_number, record number to compare with
+
+    return          int, < 0, 0 or > 0 like strcmp()
+*/
+static int _compare_mark( const char * timestamp, int record_number,
+                          const char * mark_timestamp, int mark_record_number )
+    {
+    int result = strcmp(timestamp, mark_timestamp);
+
+    if( result == 0 )
+        result = ( record_number > mark_record_number ) - ( record_number < mark_record_number );
+
+    return result;
+    }
+
+
+/*  function        static int _save_hwm( void )
+
+    brief           Writes the newest record of this transfer as the new
+                    high-water mark of the meter that is currently connected.
+                    The mark is written to a temporary file which is synced
+                    and renamed, so a crash leaves either the old or the new
+                    mark behind.
+
+    return          int, error code
+*/
+static int _save_hwm( void )
+    {
+    char name[1024];
+    char temporary[1024 + 4];
+    FILE * f;
+    int result = NOERR;
+
+    if( ( *serial == 0 ) || ( *newest_timestamp == 0 ) )
+        return NOERR;
+    if( ( *hwm_timestamp != 0 )
+     && ( _compare_mark(newest_timestamp, newest_record_number, hwm_timestamp, hwm_record_number) <= 0 ) )
+        return NOERR;
+
+    _get_hwm_name(name, sizeof(name));
+    *strrchr(name, '/') = 0;
+    if( ( mkdir(name, 0755) != 0 ) && ( errno != EEXIST ) )
+        {
+        showerr(errno);
+        return ERR_WRITE_TO_FILE;
+        }
+    _get_hwm_name(name, sizeof(name));
+    snprintf(temporary, sizeof(temporary), "%s.new", name);
+    f = fopen(temporary, "w");
+    if( f == 0 )
+        {
+        showerr(errno);
+        return ERR_WRITE_TO_FILE;
+        }
+    if( ( fprintf(f, "%s %d\n", newest_timestamp, newest_record_number) < 0 )
+     || ( fflush(f) != 0 ) || ( fsync(fileno(f)) != 0 ) )
+        result = ERR_WRITE_TO_FILE;
+    if( fclose(f) )
+        result = ERR_WRITE_TO_FILE;
+    if( ( result == NOERR ) && ( rename(temporary, name) != 0 ) )
+        {
+        showerr(errno);
+        result = ERR_WRITE_TO_FILE;
+        }
+    if( result )
+        unlink(temporary);
+
+    return result;
+    }
+
+
+/*  function        static int _is_new_record( dataset * data )
+
+    brief           Checks a result record against the high-water mark.
+                    Records are ordered by timestamp and record number.
+                    A record that is not newer than the high-water mark was
+                    stored before. The first two records tell the order the
+                    meter sends them in. If it sends the newest records first,
+                    all records following an old one were stored before too,
+                    so end_of_new_records is set to stop the transfer.
+
+    param[in]       dataset * data, result record
+
+    return          int, TRUE if the record was not stored before
+*/
+static int _is_new_record( dataset * data )
+    {
+    int is_new;
+
+    if( ( *newest_timestamp == 0 )
+     || ( _compare_mark(data->timestamp, data->record_number, newest_timestamp, newest_record_number) > 0 ) )
+        {
+        strcpy(newest_timestamp, data->timestamp);
+        newest_record_number = data->record_number;
+        }
+
+    if( ( send_order == 0 ) && ( *last_timestamp != 0 ) )
+        send_order = _compare_mark(data->timestamp, data->record_number, last_timestamp, last_record_number);
+
+    is_new = ( *hwm_timestamp == 0 )
+          || ( _compare_mark(data->timestamp, data->record_number, hwm_timestamp, hwm_record_number) > 0 );
+    if( !is_new && ( send_order < 0 ) )
+        atomic_store(&end_of_new_records, TRUE);
+    strcpy(last_timestamp, data->timestamp);
+    last_record_number = data->record_number;
+
+    return is_new;
+    }
+
+
+/*  function        static int _keep_line( const char * line, size_t len )
+
+    brief           Keeps the line of a new record until the transfer is
+                    done, as the records may come newest first.
+
+    param[in]       const char * line, the line
+    param[in]       size_t len, the line's length
+
+    return          int, error code
+*/
+static int _keep_line( const char * line, size_t len )
+    {
+    char * p;
+    size_t * ends;
+    size_t size;
+
+    if( new_lines_len + len > new_lines_size )
+        {
+        size = new_lines_size ? 2 * new_lines_size : 64 * FORMAT_LINE_LEN;
+        while( size < new_lines_len + len )
+            size *= 2;
+        p = (char *)realloc(new_lines, size);
+        if( p == 0 )
+            return ERR_NOT_ENOUGH_MEMORY;
+        new_lines = p;
+        new_lines_size = size;
+        }
+    if( new_line_count == new_line_capacity )
+        {
+        size = new_line_capacity ? 2 * new_line_capacity : 64;
+        ends = (size_t *)realloc(new_line_ends, size * sizeof(size_t));
+        if( ends == 0 )
+            return ERR_NOT_ENOUGH_MEMORY;
+        new_line_ends = ends;
+        new_line_capacity = size;
+        }
+    memcpy(new_lines + new_lines_len, line, len);
+    new_lines_len += len;
+    new_line_ends[new_line_count++] = new_lines_len;
+
+    return NOERR;
+    }
+
+
+/*  function        static int _write_kept_lines( output * out )
+
+    brief           Writes the lines of the new records kept, oldest first,
+                    so the file appended to stays sorted by time, and frees
+                    them. On error they are freed only.
+
+    param[in]       output * out, output to log data into, 0 : free only
+
+    return          int, error code
+*/
+static int _write_kept_lines( output * out )
+    {
+    int result = NOERR;
+    size_t start;
+    size_t line;
+    size_t i;
+
+    for( i = 0; out && ( i < new_line_count ) && ( result == NOERR ); ++i )
+        {
+        line = ( send_order < 0 ) ? new_line_count - 1 - i : i;                 // oldest first
+        start = line ? new_line_ends[line - 1] : 0;
+        result = output_write(out, new_lines + start, new_line_ends[line] - start);
+        }
+
+    free(new_lines);
+    free(new_line_ends);
+    new_lines = 0;
+    new_lines_len = 0;
+    new_lines_size = 0;
+    new_line_ends = 0;
+    new_line_count = 0;
+    new_line_capacity = 0;
+
+    return result;
+    }
+
+
+/*  function        static int _hex( char c )
+
+    brief           Converts a hexadecimal digit.
+
+    param[in]       char c, hexadecimal digit
+
+    return          int, the digit's value, -1 if c is no hexadecimal digit
+*/
+static int _hex( char c )
+    {
+    if( ( c >= '0' ) && ( c <= '9' ) )
+        return c - '0';
+    if( ( c >= 'A' ) && ( c <= 'F' ) )
+        return c - 'A' + 10;
+    if( ( c >= 'a' ) && ( c <= 'f' ) )
+        return c - 'a' + 10;
+    return -1;
+    }
+
+
+/*  function        static unsigned int _explode_fields( char * elements, const char * str, char delimiter,
+                                                         unsigned int raw, size_t lines, size_t length )
+
+    brief           Divides <str> into elements separated by <delimiter> like
+                    explode() does and decodes the escape sequences in the same
+                    pass :
+                        &F&     field delimiter
+                        &S&     component delimiter
+                        &R&     repeat delimiter
+                        &E&     escape delimiter
+                        &Xhh..& hexadecimal data
+                    ('&' stands for the escape delimiter read from the header)
+                    Unknown or unterminated sequences are copied unchanged.
+                    Elements that are split into components later must keep
+                    their escape sequences, they are marked in <raw>.
+                    Characters that do not fit into an element are dropped.
+
+    param[out]      char * elements, handled as an array with <lines> lines of
+                    a length of <length>
+    param[in]       const char * str, the string to explode
+    param[in]       char delimiter, separates the string's elements
+    param[in]       unsigned int raw, bit n set : copy element n unchanged
+    param[in]       size_t lines, number of separate strings that fit into elements
+    param[in]       size_t length, maximum length of a separate string - including
+                    the terminating '0'
+
+    return          unsigned int, number of separated strings found
+*/
+static unsigned int _explode_fields( char * elements, const char * str, char delimiter,
+                                     unsigned int raw, size_t lines, size_t length )
+    {
+    const char escape = delimiters[3];
+    unsigned int line = 0;
+    char * dst = elements;
+    char * end = elements + length - 1;
+    const char * seq;
+    assert(elements);
+    assert(str);
+    assert(lines);
+    assert(length);
+
+    memset(elements, 0, lines * length);                                        // now all elements are empty
+
+    while( *str )
+        {
+        if( *str == delimiter )
+            {
+            if( ++line == lines )
+                break;
+            dst = elements + line * length;
+            end = dst + length - 1;
+            ++str;
+            continue;
+            }
+        if( ( *str == escape ) && ( escape != 0 ) && ( ( raw & (1u << line) ) == 0 ) )
+            {
+            seq = str + 1;
+            if( ( seq[0] != 0 ) && ( seq[1] == escape ) )                       // not at the end of the string
+                {
+                switch( *seq )
+                    {
+                    case 'F':
+                        if( dst < end )
+                            *dst++ = delimiters[0];
+                        str += 3;
+                        continue;
+                    case 'S':
+                        if( dst < end )
+                            *dst++ = delimiters[2];
+                        str += 3;
+                        continue;
+                    case 'R':
+                        if( dst < end )
+                            *dst++ = delimiters[1];
+                        str += 3;
+                        continue;
+                    case 'E':
+                        if( dst < end )
+                            *dst++ = escape;
+                        str += 3;
+                        continue;
+                    default:
+                        break;
+                    }
+                }
+            else if( *seq == 'X' )
+                {
+                for( ++seq; ( _hex(seq[0]) >= 0 ) && ( _hex(seq[1]) >= 0 ); seq += 2 )
+                    ;
+                if( ( *seq == escape ) && ( seq > str + 2 ) )
+                    {
+                    for( str += 2; str < seq; str += 2 )
+                        {
+                        if( dst < end )
+                            *dst++ = (char)((_hex(str[0]) << 4) | _hex(str[1]));
+                        }
+                    ++str;
+                    continue;
+                    }
+                }
+            }
+        if( dst < end )
+            *dst++ = *str;
+        ++str;
+        }
+
+    return line + 1;
+    }
+
+
+/*  function        static int _check_frame_number( int handle, char * buffer, size_t length )
+
+    brief           Checks the number of a frame read from a contour device.
 
-    param[in]       FILE * file, file to log data into
     param[in]       int handle, handle to the contour device
-    param[in]       char * buffer, buffer to interpret as an ASTM E-1394 record
+    param[in]       char * buffer, the frame
     param[in]       size_t length, the buffer's number of bytes
-    param[in]       int contour_type, type of the currntly connected contour device
 
     return          int, error code
 */
-static int _interpret_astm_frame( FILE * file, int handle, char * buffer, size_t length, int contour_type )
+static int _check_frame_number( int handle, char * buffer, size_t length )
     {
     int result;
-    char elements[NUM_OF_FIELDS * LEN_OF_FIELDS];
-    char components[NUM_OF_COMPONENTS * LEN_OF_COMPONENTS];
-    dataset data;
-    static int frame_number = 1;
     char * p;
     size_t i;
-    int j;
     char temp_buffer[16];
 
     for( i=0, p = buffer; ( (*p != STX ) && ( i < length ) ); ++p, ++i )
         ;
     ++p;
 
-    if( frame_number++ != (*p++ & 0x0f) )
+    if( frame_number++ != (*p & 0x0f) )
         {                                                                       // send NAK to get a repeated frame
         *temp_buffer = NAK;
         result = _send_astm(handle, temp_buffer, 1);
@@ -336,8 +793,42 @@ static int _interpret_astm_frame( FILE * file, int handle, char * buffer, size_t
         }
     frame_number &= 7;
 
+    return NOERR;
+    }
+
+
+/*  function        static int _interpret_astm_frame( output * out, char * buffer, size_t length, const contour_profile * profile )
+
+    brief           Interprets a frame read from a countour device. The frame
+                    given in buffer was verified for a correct transfer.
+                    Result records passing the filter are written to "out",
+                    the others are dropped as soon as a field fails.
+
+    param[in]       output * out, output to log data into
+    param[in]       char * buffer, buffer to interpret as an ASTM E-1394 record
+    param[in]       size_t length, the buffer's number of bytes
+    param[in]       const contour_profile * profile, where to find the fields
+
+    return          int, error code
+*/
+static int _interpret_astm_frame( output * out, char * buffer, size_t length, const contour_profile * profile )
+    {
+    char line[FORMAT_LINE_LEN];
+    size_t len;
+    int result;
+    char elements[NUM_OF_FIELDS * LEN_OF_FIELDS];
+    char components[NUM_OF_COMPONENTS * LEN_OF_COMPONENTS];
+    dataset data;
+    const record_filter * filter = is_filter() ? get_filter() : 0;
+    char * p;
+    size_t i;
+    int j;
+
+    for( i=0, p = buffer; ( (*p != STX ) && ( i < length ) ); ++p, ++i )
+        ;
+    p += 2;                                                                     // skip STX and frame number
+
     memset(&data, 0, sizeof(data));                                             // now every string ends with '\0'
-    explode(elements, buffer, delimiters[0], NUM_OF_FIELDS, LEN_OF_FIELDS);
     data.record_type = *p++;                                                    // this is the record type
     switch( data.record_type )
         {
@@ -346,26 +837,45 @@ static int _interpret_astm_frame( FILE * file, int handle, char * buffer, size_t
             delimiters[1] = *p++;
             delimiters[2] = *p++;
             delimiters[3] = *p;
-            explode(components, elements + (4 * LEN_OF_FIELDS), delimiters[2], NUM_OF_COMPONENTS, LEN_OF_COMPONENTS);
+            _explode_fields(elements, buffer, delimiters[0],
+                RAW_FIELD(1) | RAW_FIELD(profile->header_product_field) | RAW_FIELD(profile->header_product_field + 1),
+                NUM_OF_FIELDS, LEN_OF_FIELDS);
+            _explode_fields(components, elements + (profile->header_product_field * LEN_OF_FIELDS), delimiters[2], 0,
+                NUM_OF_COMPONENTS, LEN_OF_COMPONENTS);
             if( is_verbose() )
                 {
                 printf("%s ", components);                                      // meter product code
                 printf("%s ", components + LEN_OF_COMPONENTS);                  // meter software version etc.
                 }
-            time2ger(components, elements + (13 * LEN_OF_FIELDS));
+            memcpy(serial, components + (2 * LEN_OF_COMPONENTS), SERIAL_LEN - 1);
+            if( record_store )
+                store_set_meter(record_store, serial);
+            if( is_incremental() )
+                _load_hwm();
+            progress_set_expected(atoi(elements + (profile->header_count_field * LEN_OF_FIELDS)));
+            time2ger(components, elements + (profile->header_time_field * LEN_OF_FIELDS));
             if( is_verbose() )
                 printf("%s\n", components);                                     // time stamp
             break;
         case 'R':                                                               // Result Record
-            data.record_number = atoi(elements + LEN_OF_FIELDS);
-            strncpy(data.UTID, elements + (2 * LEN_OF_FIELDS + 3), sizeof(data.UTID) - 1);    // remove leading ^^^
-            data.result = atoi(elements + 3 * LEN_OF_FIELDS);
-            explode(components, elements + (4 * LEN_OF_FIELDS), delimiters[2], NUM_OF_COMPONENTS, LEN_OF_COMPONENTS);
+            _explode_fields(elements, buffer, delimiters[0], RAW_FIELD(profile->unit_field), NUM_OF_FIELDS, LEN_OF_FIELDS);
+            memcpy(data.timestamp, elements + (profile->timestamp_field * LEN_OF_FIELDS), profile->timestamp_len);
+            data.time_key = timestamp_key(data.timestamp);
+            data.result = atoi(elements + (profile->result_field * LEN_OF_FIELDS));
+            progress_add_record();
+            if( filter && ( !filter_time(filter, data.time_key)                 // cheap checks first
+                    || !filter_type(filter, *(elements + (profile->utid_field * LEN_OF_FIELDS + profile->utid_skip)))
+                    || !filter_value(filter, data.result) ) )
+                break;
+            data.record_number = atoi(elements + (profile->record_number_field * LEN_OF_FIELDS));
+            memcpy(data.UTID, elements + (profile->utid_field * LEN_OF_FIELDS + profile->utid_skip), sizeof(data.UTID) - 1);
+            _explode_fields(components, elements + (profile->unit_field * LEN_OF_FIELDS), delimiters[2], 0,
+                NUM_OF_COMPONENTS, LEN_OF_COMPONENTS);
             memcpy(data.unit, components, sizeof(data.unit) - 1);
 
-            if( strlen(elements + (6 * LEN_OF_FIELDS)) )
+            if( *(elements + (profile->flags_field * LEN_OF_FIELDS)) )
                 {
-                i = explode(components, elements + (6 * LEN_OF_FIELDS), '/', NUM_OF_COMPONENTS, LEN_OF_COMPONENTS);
+                i = explode(components, elements + (profile->flags_field * LEN_OF_FIELDS), '/', NUM_OF_COMPONENTS, LEN_OF_COMPONENTS);
                 if( i > 9 )
                     i = 9;
                 for( j = 0; j < i; ++j )
@@ -385,16 +895,21 @@ static int _interpret_astm_frame( FILE * file, int handle, char * buffer, size_t
                     }
                 *(data.flags + j) = 0;
                 }
-            if( contour_type == CONTOUR_NEXT_ONE )
-                strncpy(data.timestamp, elements + (8 * LEN_OF_FIELDS), 14);
-            else
-                strncpy(data.timestamp, elements + (8 * LEN_OF_FIELDS), 12);
-            printline(&data, file);
-            if( !is_verbose() )
-                printf("%c%4d", CR, data.record_number);                        // show progress
-            fflush(stdout);
+            if( filter && !filter_markers(filter, data.flags, sizeof(data.flags)) )
+                break;
+            if( is_incremental() && !_is_new_record(&data) )
+                break;
+            len = is_json_out() ? format_json(&data, line) : format_line(&data, line);
+            if( ( is_verbose() || is_debug() ) && ( out->fd != STDOUT_FILENO ) )
+                printf("%s", line);
+            result = is_incremental() ? _keep_line(line, len) : output_write(out, line, len);
+            if( ( result == NOERR ) && record_store )
+                result = store_add(record_store, &data);
+            if( result )
+                return result;
             break;
         case 'L':                                                               // Message Terminator Record
+            _explode_fields(elements, buffer, delimiters[0], 0, NUM_OF_FIELDS, LEN_OF_FIELDS);
             if( *(elements + (3 * LEN_OF_FIELDS)) != 'N' )
                 return ERR_MESSAGE_TERMINATOR;
             break;
@@ -409,57 +924,317 @@ static int _interpret_astm_frame( FILE * file, int handle, char * buffer, size_t
     }
 
 
-/*  function        int data_transfer_mode( int handle, int contour_type )
+/*  function        static int _open_capture( int contour_type )
 
-    brief           Reads in data using ASTM Data Transfer Mode
-                    Reads until no more data available (ETX in last telegram).
+    brief           Opens the raw capture file if a name is given and writes
+                    its header.
 
-    param[in]       int handle, handle to the contour device
     param[in]       int contour_type, type of the currntly connected contour device
 
     return          int, error code
 */
-int data_transfer_mode( int handle, int contour_type )
+static int _open_capture( int contour_type )
     {
     const char * filename;
-    FILE * file = 0;
+
+    filename = get_capture_name();
+    if( *filename == 0 )
+        return NOERR;
+
+    capture_file = fopen(filename, "w");
+    if( capture_file == 0 )
+        {
+        showerr(errno);
+        return ERR_OPEN_LOG_FILE;
+        }
+    if( fprintf(capture_file, "%s %04x\n", CAPTURE_MAGIC, contour_type & 0xffff) != CAPTURE_HEADER_LEN )
+        return ERR_WRITE_TO_FILE;
+
+    return NOERR;
+    }
+
+
+/*  function        static void * _decoder_thread( void * arg )
+
+    brief           Decoder thread : interprets the frames put into the ring
+                    by the reader until the reader closes the ring and it is
+                    empty. After an error or if all new records are read the
+                    remaining frames are dropped.
+
+    param[in]       void * arg, the decoder
+
+    return          void *, unused
+*/
+static void * _decoder_thread( void * arg )
+    {
+    decoder * dec = (decoder *)arg;
+    char * buffer;
     size_t length;
-    char buffer[FRAME_LEN];
     int result = NOERR;
 
-    filename = get_outfile_name();
-    if( *filename != 0 )
+    while( ( buffer = ring_wait_read(&dec->frames, &length) ) != 0 )
         {
-        file = fopen(filename, "w+");
-        if( file == 0 )
+        if( ( result == NOERR ) && !atomic_load(&end_of_new_records) )
             {
-            result = errno;
-            showerr(result);
-            return ERR_OPEN_LOG_FILE;
+            showbuffer(buffer, length);
+            result = _interpret_astm_frame(dec->out, buffer, length, dec->profile);
+            if( result )
+                atomic_store(&dec->result, result);
             }
+        ring_release(&dec->frames);
+        }
+
+    return 0;
+    }
+
+
+/*  function        static int _transfer( output * out, int handle, int contour_type )
+
+    brief           Reads frames until no more data available (ETX in last
+                    telegram) or all new records are read.
+                    The frames are decoded by the decoder thread.
+
+    param[in]       output * out, output to log data into
+    param[in]       int handle, handle to the contour device
+    param[in]       int contour_type, type of the currntly connected contour device
+
+    return          int, error code
+*/
+static int _transfer( output * out, int handle, int contour_type )
+    {
+    decoder dec;
+    pthread_t thread;
+    char * buffer;
+    size_t length;
+    int last = FALSE;
+    int result = NOERR;
+    int decoder_result;
+    char c;
+
+    delimiters[0] = '|';                                                        // every session starts with a header record
+    delimiters[3] = 0;
+    frame_number = 1;
+    *serial = 0;
+    *hwm_timestamp = 0;
+    *newest_timestamp = 0;
+    *last_timestamp = 0;
+    last_record_number = 0;
+    send_order = 0;
+    atomic_store(&end_of_new_records, FALSE);
+    progress_start(!is_verbose() && ( replay_data == 0 ) && ( out->fd != STDOUT_FILENO ));
+
+    dec.profile = get_contour_profile(contour_type);                            // selected once per session
+    if( dec.profile == 0 )
+        return ERR_UNKNOWN_METER;
+    result = ring_init(&dec.frames, RING_SLOTS, FRAME_LEN + 1);
+    if( result )
+        return result;
+    dec.out = out;
+    atomic_init(&dec.result, NOERR);
+    if( pthread_create(&thread, 0, _decoder_thread, &dec) )
+        {
+        ring_free(&dec.frames);
+        return ERR_START_THREAD;
         }
 
     do
         {
+        buffer = ring_wait_write(&dec.frames);
         result = _read_astm_frame(handle, buffer, FRAME_LEN, &length);
         if( result )
-            return result;
-        showbuffer(buffer, length);
-        buffer[length] = 0;
-        result = _interpret_astm_frame(file, handle, buffer, length, contour_type);
+            break;
+        progress_add_bytes(length);
+        result = _check_frame_number(handle, buffer, length);
         if( result )
-            return result;
+            break;
+        buffer[length] = 0;
+        last = ( buffer[length - 5] == ETX );
+        ring_put(&dec.frames, length);
+        if( is_incremental() && !last )                                         // the decoder decides if another frame is wanted
+            ring_wait_empty(&dec.frames);
+        if( atomic_load(&dec.result) )
+            break;
+        }
+    while( !last && !atomic_load(&end_of_new_records) );
+
+    if( ( result == NOERR ) && ( atomic_load(&dec.result) == NOERR ) )
+        {
+        c = last ? NAK : EOT;                                                   // EOT : receiver interrupt
+        result = _send_astm(handle, &c, 1);
         }
-    while( buffer[length - 5] != ETX );
 
-    printf("\n");
+    ring_close(&dec.frames);
+    pthread_join(thread, 0);
+    ring_free(&dec.frames);
+    decoder_result = atomic_load(&dec.result);
+    if( result == NOERR )
+        result = decoder_result;
+    decoder_result = _write_kept_lines(( result == NOERR ) ? out : 0);
+    if( result == NOERR )
+        result = decoder_result;
+
+    progress_finish(result);
+    if( replay_data == 0 )
+        printf("\n");
+
+    if( ( result == NOERR ) && atomic_load(&end_of_new_records) )
+        verbose("All new records read, transfer stopped\n");
+
+    return result;
+    }
+
+
+/*  function        int data_transfer_mode( int handle, int contour_type )
+
+    brief           Reads in data using ASTM Data Transfer Mode
+                    Reads until no more data available (ETX in last telegram).
+
+    param[in]       int handle, handle to the contour device
+    param[in]       int contour_type, type of the currntly connected contour device
 
-    *buffer = NAK;
-    result = _send_astm(handle, buffer, 1);
+    return          int, error code
+*/
+int data_transfer_mode( int handle, int contour_type )
+    {
+    output out;
+    store st;
+    int result;
+    int close_result;
+
+    result = output_open(&out, get_outfile_name(), is_incremental() ? OUTPUT_APPEND : OUTPUT_REPLACE);
     if( result )
         return result;
 
-    if( file != 0 )
-        fclose(file);
+    if( strlen(get_store_name()) != 0 )
+        {
+        result = store_open(&st, get_store_name());
+        if( result == NOERR )
+            record_store = &st;
+        }
+    if( ( result == NOERR ) && ( replay_data == 0 ) )
+        result = _open_capture(contour_type);
+    if( result == NOERR )
+        result = _transfer(&out, handle, contour_type);
+
+    if( capture_file != 0 )
+        {
+        fclose(capture_file);
+        capture_file = 0;
+        }
+
+    if( record_store != 0 )
+        {
+        close_result = store_close(record_store, result == NOERR);
+        if( result == NOERR )
+            result = close_result;
+        record_store = 0;
+        }
+    close_result = output_close(&out, result == NOERR);
+    if( result == NOERR )
+        result = close_result;
+    if( ( result == NOERR ) && is_incremental() )                               // records first, then the high-water mark
+        result = _save_hwm();
+
+    return result;
+    }
+
+
+/*  function        int replay_capture( const char * reports, size_t size, int contour_type, output * out )
+
+    brief           Replays the reports of a raw capture through the ASTM
+                    framing, checksum and record interpretation.
+
+    param[in]       const char * reports, the reports of the raw capture
+                    (without the capture's header)
+    param[in]       size_t size, number of bytes in reports
+    param[in]       int contour_type, type of the contour device captured
+    param[in]       output * out, output to log data into
+
+    return          int, error code
+*/
+int replay_capture( const char * reports, size_t size, int contour_type, output * out )
+    {
+    int result;
+
+    replay_data = reports;
+    replay_size = size;
+    replay_pos = 0;
+    result = _transfer(out, -1, contour_type);
+    replay_data = 0;
+
+    return result;
+    }
+
+
+/*  function        int decode_capture( const char * capture_name )
+
+    brief           Decodes a raw capture file offline.
+                    The whole capture is loaded into memory and replayed through
+                    data_transfer_mode(), so the output is the same as the
+                    output of a live download.
+
+    param[in]       const char * capture_name, name of the raw capture file
+
+    return          int, error code
+*/
+int decode_capture( const char * capture_name )
+    {
+    FILE * f;
+    char * data;
+    long size;
+    unsigned int contour_type;
+    struct timespec start;
+    int result;
+
+    f = fopen(capture_name, "r");
+    if( f == 0 )
+        {
+        showerr(errno);
+        return ERR_OPEN_IN_FILE;
+        }
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if( size < CAPTURE_HEADER_LEN )
+        {
+        fclose(f);
+        return ERR_CAPTURE_FORMAT;
+        }
+    data = (char *)malloc((size_t)size + 1);
+    if( data == 0 )
+        {
+        fclose(f);
+        return ERR_NOT_ENOUGH_MEMORY;
+        }
+    if( fread(data, (size_t)size, 1, f) != 1 )
+        {
+        result = errno;
+        showerr(result);
+        free(data);
+        fclose(f);
+        return ERR_OPEN_IN_FILE;
+        }
+    fclose(f);
+    data[size] = 0;
+
+    if( ( memcmp(data, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC) - 1) != 0 )
+     || ( data[CAPTURE_HEADER_LEN - 1] != LF )
+     || ( sscanf(data + sizeof(CAPTURE_MAGIC), "%4x", &contour_type) != 1 ) )
+        {
+        free(data);
+        return ERR_CAPTURE_FORMAT;
+        }
+
+    replay_data = data + CAPTURE_HEADER_LEN;
+    replay_size = (size_t)size - CAPTURE_HEADER_LEN;
+    replay_pos = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    result = data_transfer_mode(-1, (int)contour_type);
+    verbose("Decoded %lu bytes in %.3f ms\n", replay_pos, seconds_since(&start) * 1000.0);
+
+    replay_data = 0;
+    free(data);
+
     return result;
     }
@@ -0,0 +1,664 @@
+/*
+    Copyright (C)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+    See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.
+    If not, see <http://www.gnu.org/licenses/>.
+
+    Klabautermann Software
+    Uwe Jantzen
+    Weingartener Straße 33
+    76297 Stutensee
+    Germany
+
+    file        bench.c
+
+    date        19.10.2026
+
+    author      Uwe Jantzen (jantzen@klabautermann-software.de)
+
+    brief       Built-in benchmarks
+
+    details     All benchmarks work on synthetic data built in memory and
+                write their output to /dev/null, so they measure the code and
+                not the meter or the disk.
+
+    project     glucotux
+    target      Linux
+    begin       03.03.2012
+
+    note
+
+    todo
+
+*/
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "errors.h"
+#include "globals.h"
+#include "utils.h"
+#include "contour.h"
+#include "output.h"
+#include "format.h"
+#include "astm.h"
+#include "files.h"
+#include "filter.h"
+#include "columns.h"
+#include "dedup.h"
+#include "gtx.h"
+#include "bench.h"
+
+
+#define BENCH_RECORDS                       2000                                // a full meter
+#define BENCH_ROUNDS                        200
+#define BENCH_FRAME_LEN                     256
+#define REPORT_PAYLOAD                      (TRANSFER_BUFFER_LEN - 4)
+#define BENCH_BLOCK_LEN                     65536
+#define BENCH_SCAN_RECORDS                  200000                              // 20 years of records
+
+
+typedef size_t (* formatter)( const dataset * data, char * buffer );
+
+static const struct
+    {
+    const char * name;
+    formatter format;
+    } formats[] =                                                               // every output format
+    {
+    { "format line",    format_line },
+    { "format csv",     format_csv },
+    { "format json",    format_json }
+    };
+
+
+/*  function        static void _report( const char * name, double records, double bytes, double seconds )
+
+    brief           Prints the result of one benchmark.
+
+    param[in]       const char * name, the benchmark's name
+    param[in]       double records, number of records handled
+    param[in]       double bytes, number of bytes handled
+    param[in]       double seconds, time used
+*/
+static void _report( const char * name, double records, double bytes, double seconds )
+    {
+    printf("%-12s %10.0f records/s  %8.1f MB/s  (%.0f records in %.3f s)\n",
+        name, records / seconds, bytes / seconds / 1e6, records, seconds);
+    }
+
+
+/*  function        static size_t _add_frame( char * reports, int number, const char * record, int last )
+
+    brief           Packs a record into an ASTM frame and splits the frame
+                    into reports as they are read from the meter.
+
+    param[out]      char * reports, buffer to append the reports to
+    param[in]       int number, the frame's number
+    param[in]       const char * record, the record
+    param[in]       int last, TRUE for the last frame of the transfer
+
+    return          size_t, number of bytes appended
+*/
+static size_t _add_frame( char * reports, int number, const char * record, int last )
+    {
+    char frame[BENCH_FRAME_LEN];
+    char * p;
+    int checksum = 0;
+    int len;
+    size_t size = 0;
+
+    len = snprintf(frame, BENCH_FRAME_LEN - 8, "%c%d%s%c%c", STX, number & 7, record, CR, last ? ETX : ETB);
+    for( p = frame + 1; *p; ++p )
+        checksum += *p;
+    len += snprintf(frame + len, 8, "%02X%c%c", checksum & 0xff, CR, LF);
+
+    for( p = frame; len > 0; p += REPORT_PAYLOAD, len -= REPORT_PAYLOAD )
+        {
+        memset(reports + size, 0, TRANSFER_BUFFER_LEN);
+        memcpy(reports + size, "ABC", 3);
+        reports[size + 3] = (char)( len > REPORT_PAYLOAD ? REPORT_PAYLOAD : len );
+        memcpy(reports + size + 4, p, (size_t)reports[size + 3]);
+        size += TRANSFER_BUFFER_LEN;
+        }
+
+    return size;
+    }
+
+
+/*  function        static char * _build_capture( int records, size_t * size )
+
+    brief           Builds the reports of a complete transfer of <records>
+                    result records. Every 7th record uses escape sequences.
+
+    param[in]       int records, number of result records
+    param[out]      size_t * size, number of bytes in the capture
+
+    return          char *, the capture, 0 if out of memory
+*/
+static char * _build_capture( int records, size_t * size )
+    {
+    static const char * const utid[] = { "Glucose", "Glucose", "Glucose", "Insulin", "Carb" };
+    static const char * const unit[] = { "mg/dL^P", "mg/dL^P", "mg/dL^P", "1^", "2^" };
+    static const char * const flags[] = { "B/M0/T1", "A/M0/T1", "F/M0/T1", "", "" };
+    char record[BENCH_FRAME_LEN];
+    char * capture;
+    int number = 1;
+    int i;
+    int k;
+
+    capture = (char *)malloc((size_t)(records + 3) * 4 * TRANSFER_BUFFER_LEN);
+    if( capture == 0 )
+        return 0;
+
+    *size = _add_frame(capture, number++, "H|\\^&||bench|Bayer7390^01.24\\01.04\\16.01.19^7396-0000000^7390-|A=1^C=00|2000||||||1|201911091712", FALSE);
+    *size += _add_frame(capture + *size, number++, "P|1", FALSE);
+    for( i = 0; i < records; ++i )
+        {
+        k = i % 5;
+        snprintf(record, BENCH_FRAME_LEN, "R|%d|^^^%s|%d|%s|%s|%s||%04d%02d%02d%02d%02d",
+            i + 1, utid[k], 80 + (i * 7) % 150,
+            ( i % 7 ) ? unit[k] : "mg&X2F&dL^P",
+            ( i % 7 ) ? "" : "70&S&180&E&",
+            flags[k], 2019 + i / 8760, 1 + (i / 720) % 12, 1 + (i / 24) % 28, i % 24, i % 60);
+        *size += _add_frame(capture + *size, number++, record, FALSE);
+        }
+    *size += _add_frame(capture + *size, number, "L|1||N", TRUE);
+
+    return capture;
+    }
+
+
+/*  function        static int _bench_decode( output * null )
+
+    brief           Decodes a transfer of a full meter from memory.
+                    This covers ASTM framing, checksums, field tokenizing
+                    including escape sequences, record interpretation and
+                    formatting.
+
+    param[in]       output * null, output
+
+    return          int, error code
+*/
+static int _bench_decode( output * null )
+    {
+    char * capture;
+    size_t size;
+    struct timespec start;
+    int result = NOERR;
+    int i;
+
+    capture = _build_capture(BENCH_RECORDS, &size);
+    if( capture == 0 )
+        return ERR_NOT_ENOUGH_MEMORY;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for( i = 0; ( i < BENCH_ROUNDS ) && ( result == NOERR ); ++i )
+        result = replay_capture(capture, size, CONTOUR_USB_NEXT_CODE, null);
+    if( result == NOERR )
+        _report("decode", (double)BENCH_RECORDS * BENCH_ROUNDS, (double)size * BENCH_ROUNDS, seconds_since(&start));
+
+    free(capture);
+
+    return result;
+    }
+
+
+/*  function        static dataset * _build_records( int records )
+
+    brief           Builds <records> records as they are read from a meter :
+                    glucose, insulin and carb values in turn.
+
+    param[in]       int records, number of records
+
+    return          dataset *, the records, 0 if out of memory
+*/
+static dataset * _build_records( int records )
+    {
+    static const char * const utid[] = { "Glucose", "Glucose", "Glucose", "Insulin", "Carb" };
+    static const char * const unit[] = { "mg/dL", "mg/dL", "mg/dL", "1", "2" };
+    static const char * const flags[] = { "B", "AN", "FNO", "", "" };
+    dataset * data;
+    int i;
+    int k;
+
+    data = (dataset *)calloc((size_t)records, sizeof(dataset));
+    if( data == 0 )
+        return 0;
+
+    for( i = 0; i < records; ++i )
+        {
+        k = i % 5;
+        snprintf(data[i].timestamp, sizeof(data[i].timestamp), "%04d%02d%02d%02d%02d",
+            2019 + i / 8760, 1 + (i / 720) % 12, 1 + (i / 24) % 28, i % 24, i % 60);
+        data[i].result = 80 + (i * 7) % 150;
+        strcpy(data[i].unit, unit[k]);
+        strcpy(data[i].flags, flags[k]);
+        strcpy(data[i].UTID, utid[k]);
+        data[i].record_type = 'R';
+        data[i].time_key = timestamp_key(data[i].timestamp);
+        data[i].record_number = i + 1;
+        }
+
+    return data;
+    }
+
+
+/*  function        static int _bench_format( void )
+
+    brief           Formats the records of a full meter in every output
+                    format. Lines are collected in a block as the writers do.
+
+    return          int, error code
+*/
+static int _bench_format( void )
+    {
+    dataset * data;
+    char * block;
+    struct timespec start;
+    double bytes;
+    size_t fill;
+    size_t f;
+    int i;
+    int j;
+
+    data = _build_records(BENCH_RECORDS);
+    block = (char *)malloc(BENCH_BLOCK_LEN);
+    if( ( data == 0 ) || ( block == 0 ) )
+        {
+        free(data);
+        free(block);
+        return ERR_NOT_ENOUGH_MEMORY;
+        }
+
+    for( f = 0; f < (sizeof(formats) / sizeof(formats[0])); ++f )
+        {
+        bytes = 0.0;
+        fill = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for( i = 0; i < BENCH_ROUNDS; ++i )
+            {
+            for( j = 0; j < BENCH_RECORDS; ++j )
+                {
+                fill += formats[f].format(data + j, block + fill);
+                if( fill > BENCH_BLOCK_LEN - FORMAT_LINE_LEN )
+                    {
+                    bytes += (double)fill;
+                    fill = 0;
+                    }
+                }
+            }
+        bytes += (double)fill;
+        _report(formats[f].name, (double)BENCH_RECORDS * BENCH_ROUNDS, bytes, seconds_since(&start));
+        }
+
+    free(block);
+    free(data);
+
+    return NOERR;
+    }
+
+
+/*  function        static int _bench_parse_text( const char * name, const char * text, size_t size, line_parser parse,
+                        const record_filter * filter )
+
+    brief           Parses the lines of a data file held in memory.
+
+    param[in]       const char * name, the benchmark's name
+    param[in]       const char * text, the lines
+    param[in]       size_t size, number of bytes in text
+    param[in]       line_parser parse, parser of the text's data order
+    param[in]       const record_filter * filter, records to take, 0 : all
+
+    return          int, error code
+*/
+static int _bench_parse_text( const char * name, const char * text, size_t size, line_parser parse,
+    const record_filter * filter )
+    {
+    dataset data;
+    struct timespec start;
+    const char * p;
+    const char * eol;
+    int result = NOERR;
+    int lines = 0;
+    int i;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for( i = 0; ( i < BENCH_ROUNDS ) && ( result == NOERR ); ++i )
+        {
+        for( p = text; ( p < text + size ) && ( result == NOERR ); p = eol + 1 )
+            {
+            eol = memchr(p, '\n', (size_t)(text + size - p));
+            result = parse(&data, p, (size_t)(eol - p), filter);
+            if( result == ERR_FILTERED )
+                result = NOERR;
+            ++lines;
+            }
+        }
+    if( result == NOERR )
+        _report(name, (double)lines, (double)size * BENCH_ROUNDS, seconds_since(&start));
+
+    return result;
+    }
+
+
+/*  function        static int _bench_parse( void )
+
+    brief           Parses the records of a full meter written in the
+                    current and in the old data order (glucose only), and
+                    in the current one again taking the glucose values of
+                    the second half of the time range only.
+
+    return          int, error code
+*/
+static int _bench_parse( void )
+    {
+    static const char old_flags[] = { 'B', 'A', 'F', 'N', 'N' };
+    dataset * data;
+    record_filter filter;
+    char * text;
+    size_t size = 0;
+    int result;
+    int i;
+
+    data = _build_records(BENCH_RECORDS);
+    text = (char *)malloc((size_t)BENCH_RECORDS * FORMAT_LINE_LEN);
+    if( ( data == 0 ) || ( text == 0 ) )
+        {
+        free(data);
+        free(text);
+        return ERR_NOT_ENOUGH_MEMORY;
+        }
+
+    for( i = 0; i < BENCH_RECORDS; ++i )
+        size += format_line(data + i, text + size);
+    result = _bench_parse_text("parse line", text, size, parse_current, 0);
+
+    filter_init(&filter);
+    filter.from = data[BENCH_RECORDS / 2].time_key;
+    filter.types = FILTER_GLUCOSE;
+    if( result == NOERR )
+        result = _bench_parse_text("parse filter", text, size, parse_current, &filter);
+
+    for( i = 0, size = 0; ( i < BENCH_RECORDS ) && ( result == NOERR ); ++i )
+        size += (size_t)snprintf(text + size, FORMAT_LINE_LEN, "R %4d  Glucose  %-14s  %dmg/dL  %c\n",
+            data[i].record_number, data[i].timestamp, data[i].result, old_flags[i % 5]);
+    if( result == NOERR )
+        result = _bench_parse_text("parse old", text, size, parse_old, 0);
+
+    free(text);
+    free(data);
+
+    return result;
+    }
+
+
+/*  function        static int _bench_scan( void )
+
+    brief           Sums the glucose values of the second half of the time
+                    range, once over the records and once over their columns.
+
+    return          int, error code
+*/
+static int _bench_scan( void )
+    {
+    static volatile long long sum;                                              // keeps the loops from being optimized away
+    dataset * data;
+    columns c;
+    struct timespec start;
+    long long from;
+    long long total;
+    int result;
+    int i;
+    int j;
+
+    data = _build_records(BENCH_SCAN_RECORDS);
+    if( data == 0 )
+        return ERR_NOT_ENOUGH_MEMORY;
+    result = columns_init(&c, BENCH_SCAN_RECORDS);
+    if( result == NOERR )
+        result = columns_from_datasets(&c, data, BENCH_SCAN_RECORDS);
+    if( result )
+        {
+        free(data);
+        columns_free(&c);
+        return result;
+        }
+    from = data[BENCH_SCAN_RECORDS / 2].time_key;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for( i = 0, total = 0; i < BENCH_ROUNDS; ++i )
+        {
+        for( j = 0; j < BENCH_SCAN_RECORDS; ++j )
+            {
+            if( ( data[j].time_key >= from ) && ( strcmp(data[j].UTID, "Glucose") == 0 ) )
+                total += data[j].result;
+            }
+        }
+    sum = total;
+    _report("scan rows", (double)BENCH_SCAN_RECORDS * BENCH_ROUNDS,
+        (double)BENCH_SCAN_RECORDS * BENCH_ROUNDS * sizeof(dataset), seconds_since(&start));
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for( i = 0, total = 0; i < BENCH_ROUNDS; ++i )
+        {
+        for( j = 0; j < BENCH_SCAN_RECORDS; ++j )
+            {
+            if( ( c.time[j] >= from ) && ( c.type[j] == TYPE_GLUCOSE ) )
+                total += c.value[j];
+            }
+        }
+    sum = total;
+    _report("scan columns", (double)BENCH_SCAN_RECORDS * BENCH_ROUNDS,
+        (double)BENCH_SCAN_RECORDS * BENCH_ROUNDS * (sizeof(long long) + sizeof(int) + 1), seconds_since(&start));
+    (void)sum;
+
+    columns_free(&c);
+    free(data);
+
+    return NOERR;
+    }
+
+
+/*  function        static int _bench_dedup( void )
+
+    brief           Finds the duplicates of three downloads of 100000 records
+                    each, every one overlapping the one before by half. The
+                    downloads number their records from 1 and are taken in
+                    a scattered order.
+
+    return          int, error code
+*/
+static int _bench_dedup( void )
+    {
+    dataset * data;
+    dataset * records;
+    record_set set;
+    struct timespec start;
+    size_t per_download = BENCH_SCAN_RECORDS / 2;
+    size_t total = 3 * per_download;
+    size_t unique = 0;
+    size_t i;
+    size_t k;
+    int added;
+    int result = NOERR;
+    int round;
+
+    data = _build_records(BENCH_SCAN_RECORDS);
+    records = (dataset *)malloc(total * sizeof(dataset));
+    if( ( data == 0 ) || ( records == 0 ) )
+        {
+        free(data);
+        free(records);
+        return ERR_NOT_ENOUGH_MEMORY;
+        }
+    for( i = 0; i < total; ++i )
+        {
+        records[i] = data[( i / per_download ) * per_download / 2 + i % per_download];
+        records[i].record_number = (int)( i % per_download ) + 1;
+        }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for( round = 0; ( round < BENCH_ROUNDS / 20 ) && ( result == NOERR ); ++round )
+        {
+        result = record_set_init(&set, 0);
+        for( i = 0, unique = 0; ( i < total ) && ( result == NOERR ); ++i )
+            {
+            k = ( i * 7919 ) % total;                                           // 7919 is prime, every record is taken once
+            result = record_set_add(&set, records + k, &added);
+            unique += (size_t)added;
+            }
+        record_set_free(&set);
+        }
+    if( result == NOERR )
+        {
+        _report("dedup", (double)total * ( BENCH_ROUNDS / 20 ), (double)total * ( BENCH_ROUNDS / 20 ) * sizeof(dataset),
+            seconds_since(&start));
+        printf("             %lu of %lu records unique\n", unique, total);
+        }
+
+    free(records);
+    free(data);
+
+    return result;
+    }
+
+
+/*  function        static int _by_time( const void * a, const void * b )
+
+    brief           Compares two records by their time for qsort.
+
+    param[in]       const void * a, the first record
+    param[in]       const void * b, the second record
+
+    return          int, <0, 0 or >0
+*/
+static int _by_time( const void * a, const void * b )
+    {
+    long long ta = ((const dataset *)a)->time_key;
+    long long tb = ((const dataset *)b)->time_key;
+
+    return ( ta > tb ) - ( ta < tb );
+    }
+
+
+/*  function        static int _bench_gtx( void )
+
+    brief           Writes 200000 records to a .gtx file once and reads them
+                    back, mapping the file anew every round.
+
+    return          int, error code
+*/
+static int _bench_gtx( void )
+    {
+    char name[] = "/tmp/glucotux-benchXXXXXX.gtx";
+    dataset * data;
+    dataset record;
+    gtx_writer w;
+    gtx g;
+    gtx_block block;
+    struct timespec start;
+    size_t b;
+    size_t i;
+    int fd;
+    int result;
+    int round;
+
+    data = _build_records(BENCH_SCAN_RECORDS);
+    if( data == 0 )
+        return ERR_NOT_ENOUGH_MEMORY;
+    qsort(data, BENCH_SCAN_RECORDS, sizeof(dataset), _by_time);                 // a .gtx file is sorted by time
+    fd = mkstemps(name, 4);
+    if( fd < 0 )
+        {
+        free(data);
+        return errno;
+        }
+    close(fd);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    result = gtx_create(&w, name);
+    for( i = 0; ( i < BENCH_SCAN_RECORDS ) && ( result == NOERR ); ++i )
+        result = gtx_write(&w, data + i);
+    if( w.f )
+        result = gtx_finish(&w, result);
+    if( result == NOERR )
+        _report("write gtx", (double)BENCH_SCAN_RECORDS, (double)BENCH_SCAN_RECORDS * sizeof(dataset),
+            seconds_since(&start));
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for( round = 0; ( round < BENCH_ROUNDS / 20 ) && ( result == NOERR ); ++round )
+        {
+        result = gtx_open(&g, name);
+        for( b = 0; ( result == NOERR ) && ( b < g.header->blocks ); ++b )
+            {
+            gtx_get_block(&g, b, &block);
+            for( i = 0; i < block.count; ++i )
+                gtx_get(&g, &block, i, &record);
+            }
+        if( result == NOERR )
+            gtx_close(&g);
+        }
+    if( result == NOERR )
+        _report("load gtx", (double)BENCH_SCAN_RECORDS * ( BENCH_ROUNDS / 20 ),
+            (double)BENCH_SCAN_RECORDS * ( BENCH_ROUNDS / 20 ) * sizeof(dataset), seconds_since(&start));
+
+    unlink(name);
+    free(data);
+
+    return result;
+    }
+
+
+/*  function        int benchmark( void )
+
+    brief           Runs all benchmarks.
+
+    return          int, error code
+*/
+int benchmark( void )
+    {
+    output null;
+    int result;
+    int close_result;
+
+    result = output_open(&null, "/dev/null", OUTPUT_DIRECT);
+    if( result )
+        {
+        showerr(result);
+        return result;
+        }
+
+    result = _bench_decode(&null);
+    if( result == NOERR )
+        result = _bench_format();
+    if( result == NOERR )
+        result = _bench_parse();
+    if( result == NOERR )
+        result = _bench_scan();
+    if( result == NOERR )
+        result = _bench_dedup();
+    if( result == NOERR )
+        result = _bench_gtx();
+
+    close_result = output_close(&null, TRUE);
+    if( result == NOERR )
+        result = close_result;
+    showerr(result);
+
+    return result;
+    }
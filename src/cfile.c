@@ -0,0 +1,555 @@
+/*
+    Copyright (C)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+    See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.
+    If not, see <http://www.gnu.org/licenses/>.
+
+    Klabautermann Software
+    Uwe Jantzen
+    Weingartener Straße 33
+    76297 Stutensee
+    Germany
+
+    file        cfile.c
+
+    date        19.10.2026
+
+    author      Uwe Jantzen (jantzen@klabautermann-software.de)
+
+    brief       Transparently compressed files
+
+    details     cfopen() works like fopen() but reads and writes gzip and
+                zstd compressed files as if they were plain ones. The
+                (de)compression is streamed through a stdio stream made with
+                fopencookie(), so the callers keep using getline(), fwrite()
+                and fclose().
+                A file read is recognized by its magic bytes, a file written
+                is compressed if its name ends with ".gz" or ".zst".
+                Appending adds a new gzip member / zstd frame, both formats
+                read such files as one stream.
+                Reading may be rewound to the start, that's the only seek
+                possible.
+                gzip needs zlib (HAVE_ZLIB, on by default, make zlib=0 to
+                build without), zstd needs libzstd (HAVE_ZSTD, make zstd=1).
+                Opening a compressed file without the library fails with
+                errno set to ENOTSUP.
+
+    project     glucotux
+    target      Linux
+    begin       03.03.2012
+
+    note
+
+    todo
+
+*/
+
+
+#define _GNU_SOURCE                                                             // fopencookie()
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif  // HAVE_ZLIB
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif  // HAVE_ZSTD
+#include "debug.h"
+#include "cfile.h"
+
+
+#define MAGIC_LEN                           4
+#define GZIP_BUFFER_LEN                     (128 * 1024)
+
+
+static const unsigned char gzip_magic[] = { 0x1f, 0x8b };
+static const unsigned char zstd_magic[] = { 0x28, 0xb5, 0x2f, 0xfd };
+
+
+#ifdef HAVE_ZLIB
+
+/*  function        static ssize_t _gz_read( void * cookie, char * buffer, size_t size )
+
+    brief           Reads decompressed bytes from a gzip stream.
+
+    param[in]       void * cookie, the gzFile
+    param[out]      char * buffer, buffer to fill
+    param[in]       size_t size, size of buffer
+
+    return          ssize_t, number of bytes read, 0 at the end, -1 on error
+*/
+static ssize_t _gz_read( void * cookie, char * buffer, size_t size )
+    {
+    return gzread((gzFile)cookie, buffer, ( size > INT_MAX ) ? INT_MAX : (unsigned int)size);
+    }
+
+
+/*  function        static ssize_t _gz_write( void * cookie, const char * buffer, size_t size )
+
+    brief           Compresses bytes into a gzip stream.
+
+    param[in]       void * cookie, the gzFile
+    param[in]       const char * buffer, bytes to write
+    param[in]       size_t size, number of bytes to write
+
+    return          ssize_t, number of bytes written, 0 on error
+*/
+static ssize_t _gz_write( void * cookie, const char * buffer, size_t size )
+    {
+    return gzwrite((gzFile)cookie, buffer, ( size > INT_MAX ) ? INT_MAX : (unsigned int)size);
+    }
+
+
+/*  function        static int _gz_seek( void * cookie, off64_t * offset, int whence )
+
+    brief           Rewinds a gzip stream being read.
+
+    param[in]       void * cookie, the gzFile
+    param[in/out]   off64_t * offset, must be 0
+    param[in]       int whence, must be SEEK_SET
+
+    return          int, 0 : done, -1 : not possible
+*/
+static int _gz_seek( void * cookie, off64_t * offset, int whence )
+    {
+    if( ( *offset != 0 ) || ( whence != SEEK_SET ) )
+        return -1;
+
+    return gzrewind((gzFile)cookie);
+    }
+
+
+/*  function        static int _gz_close( void * cookie )
+
+    brief           Finishes a gzip stream and closes its file.
+
+    param[in]       void * cookie, the gzFile
+
+    return          int, 0 : done, EOF : error
+*/
+static int _gz_close( void * cookie )
+    {
+    return ( gzclose((gzFile)cookie) == Z_OK ) ? 0 : EOF;
+    }
+
+
+/*  function        static FILE * _gz_open( int fd, const char * mode )
+
+    brief           Makes a stdio stream of a gzip stream on <fd>.
+
+    param[in]       int fd, the file, owned by the stream afterwards
+    param[in]       const char * mode, "r", "w" or "a"
+
+    return          FILE *, the stream, 0 on error
+*/
+static FILE * _gz_open( int fd, const char * mode )
+    {
+    cookie_io_functions_t functions = { _gz_read, _gz_write, _gz_seek, _gz_close };
+    gzFile gz;
+    FILE * f;
+
+    gz = gzdopen(fd, ( *mode == 'r' ) ? "rb" : "wb");
+    if( gz == 0 )
+        {
+        close(fd);
+        return 0;
+        }
+    gzbuffer(gz, GZIP_BUFFER_LEN);
+
+    f = fopencookie(gz, mode, functions);
+    if( f == 0 )
+        gzclose(gz);
+
+    return f;
+    }
+
+#endif  // HAVE_ZLIB
+
+
+#ifdef HAVE_ZSTD
+
+typedef struct zstd_stream_t
+    {
+    int fd;
+    int writing;
+    ZSTD_DCtx * dctx;
+    ZSTD_CCtx * cctx;
+    ZSTD_inBuffer in;                                                           // compressed bytes read, not yet decoded
+    char * buffer;                                                              // compressed bytes
+    size_t buffer_len;
+    } zstd_stream;
+
+
+/*  function        static int _zstd_flush( zstd_stream * z, ZSTD_outBuffer * out )
+
+    brief           Writes the compressed bytes collected in <out> to the
+                    file.
+
+    param[in]       zstd_stream * z, the stream
+    param[in/out]   ZSTD_outBuffer * out, compressed bytes, empty afterwards
+
+    return          int, 0 : done, -1 : error
+*/
+static int _zstd_flush( zstd_stream * z, ZSTD_outBuffer * out )
+    {
+    const char * p = (const char *)out->dst;
+    ssize_t n;
+
+    while( out->pos )
+        {
+        n = write(z->fd, p, out->pos);
+        if( n < 0 )
+            {
+            if( errno == EINTR )
+                continue;
+            return -1;
+            }
+        p += n;
+        out->pos -= (size_t)n;
+        }
+
+    return 0;
+    }
+
+
+/*  function        static ssize_t _zstd_read( void * cookie, char * buffer, size_t size )
+
+    brief           Reads decompressed bytes from a zstd stream.
+
+    param[in]       void * cookie, the zstd_stream
+    param[out]      char * buffer, buffer to fill
+    param[in]       size_t size, size of buffer
+
+    return          ssize_t, number of bytes read, 0 at the end, -1 on error
+*/
+static ssize_t _zstd_read( void * cookie, char * buffer, size_t size )
+    {
+    zstd_stream * z = (zstd_stream *)cookie;
+    ZSTD_outBuffer out = { buffer, size, 0 };
+    ssize_t n;
+    size_t ret;
+
+    while( out.pos == 0 )
+        {
+        ret = ZSTD_decompressStream(z->dctx, &out, &z->in);                     // also flushes what the decoder still holds
+        if( ZSTD_isError(ret) )
+            {
+            debug("zstd : %s\n", ZSTD_getErrorName(ret));
+            errno = EIO;
+            return -1;
+            }
+        if( ( out.pos != 0 ) || ( z->in.pos < z->in.size ) )
+            continue;
+        n = read(z->fd, z->buffer, z->buffer_len);
+        if( n < 0 )
+            {
+            if( errno == EINTR )
+                continue;
+            return -1;
+            }
+        if( n == 0 )
+            break;                                                              // end of file
+        z->in.size = (size_t)n;
+        z->in.pos = 0;
+        }
+
+    return (ssize_t)out.pos;
+    }
+
+
+/*  function        static ssize_t _zstd_write( void * cookie, const char * buffer, size_t size )
+
+    brief           Compresses bytes into a zstd stream.
+
+    param[in]       void * cookie, the zstd_stream
+    param[in]       const char * buffer, bytes to write
+    param[in]       size_t size, number of bytes to write
+
+    return          ssize_t, number of bytes written, 0 on error
+*/
+static ssize_t _zstd_write( void * cookie, const char * buffer, size_t size )
+    {
+    zstd_stream * z = (zstd_stream *)cookie;
+    ZSTD_inBuffer in = { buffer, size, 0 };
+    ZSTD_outBuffer out = { z->buffer, z->buffer_len, 0 };
+    size_t ret;
+
+    while( in.pos < in.size )
+        {
+        ret = ZSTD_compressStream2(z->cctx, &out, &in, ZSTD_e_continue);
+        if( ZSTD_isError(ret) || _zstd_flush(z, &out) )
+            return 0;
+        }
+
+    return (ssize_t)size;
+    }
+
+
+/*  function        static int _zstd_seek( void * cookie, off64_t * offset, int whence )
+
+    brief           Rewinds a zstd stream being read.
+
+    param[in]       void * cookie, the zstd_stream
+    param[in/out]   off64_t * offset, must be 0
+    param[in]       int whence, must be SEEK_SET
+
+    return          int, 0 : done, -1 : not possible
+*/
+static int _zstd_seek( void * cookie, off64_t * offset, int whence )
+    {
+    zstd_stream * z = (zstd_stream *)cookie;
+
+    if( z->writing || ( *offset != 0 ) || ( whence != SEEK_SET ) || ( lseek(z->fd, 0, SEEK_SET) != 0 ) )
+        return -1;
+    ZSTD_DCtx_reset(z->dctx, ZSTD_reset_session_only);
+    z->in.size = 0;
+    z->in.pos = 0;
+
+    return 0;
+    }
+
+
+/*  function        static int _zstd_close( void * cookie )
+
+    brief           Finishes a zstd stream and closes its file.
+
+    param[in]       void * cookie, the zstd_stream
+
+    return          int, 0 : done, EOF : error
+*/
+static int _zstd_close( void * cookie )
+    {
+    zstd_stream * z = (zstd_stream *)cookie;
+    ZSTD_inBuffer in = { 0, 0, 0 };
+    ZSTD_outBuffer out = { z->buffer, z->buffer_len, 0 };
+    size_t remaining = 1;
+    int result = 0;
+
+    if( z->writing )
+        {
+        while( remaining && ( result == 0 ) )
+            {
+            remaining = ZSTD_compressStream2(z->cctx, &out, &in, ZSTD_e_end);
+            if( ZSTD_isError(remaining) || _zstd_flush(z, &out) )
+                result = EOF;
+            }
+        }
+    if( close(z->fd) )
+        result = EOF;
+    ZSTD_freeDCtx(z->dctx);
+    ZSTD_freeCCtx(z->cctx);
+    free(z->buffer);
+    free(z);
+
+    return result;
+    }
+
+
+/*  function        static FILE * _zstd_open( int fd, const char * mode )
+
+    brief           Makes a stdio stream of a zstd stream on <fd>.
+
+    param[in]       int fd, the file, owned by the stream afterwards
+    param[in]       const char * mode, "r", "w" or "a"
+
+    return          FILE *, the stream, 0 on error
+*/
+static FILE * _zstd_open( int fd, const char * mode )
+    {
+    cookie_io_functions_t functions = { _zstd_read, _zstd_write, _zstd_seek, _zstd_close };
+    zstd_stream * z;
+    FILE * f = 0;
+
+    z = (zstd_stream *)calloc(1, sizeof(zstd_stream));
+    if( z == 0 )
+        {
+        close(fd);
+        return 0;
+        }
+    z->fd = fd;
+    z->writing = ( *mode != 'r' );
+    if( z->writing )
+        {
+        z->cctx = ZSTD_createCCtx();
+        z->buffer_len = ZSTD_CStreamOutSize();
+        }
+    else
+        {
+        z->dctx = ZSTD_createDCtx();
+        z->buffer_len = ZSTD_DStreamInSize();
+        }
+    z->buffer = (char *)malloc(z->buffer_len);
+    z->in.src = z->buffer;
+
+    if( ( z->buffer != 0 ) && ( ( z->cctx != 0 ) || ( z->dctx != 0 ) ) )
+        f = fopencookie(z, mode, functions);
+    if( f == 0 )
+        {
+        z->writing = 0;                                                         // nothing to finish
+        _zstd_close(z);
+        }
+
+    return f;
+    }
+
+#endif  // HAVE_ZSTD
+
+
+/*  function        int cfile_kind_of_name( const char * name )
+
+    brief           Returns the compression a file is written with, given
+                    by its name's extension.
+
+    param[in]       const char * name, file name
+
+    return          int, CFILE_PLAIN, CFILE_GZIP or CFILE_ZSTD
+*/
+int cfile_kind_of_name( const char * name )
+    {
+    size_t len = strlen(name);
+
+    if( ( len > 3 ) && ( strcmp(name + len - 3, ".gz") == 0 ) )
+        return CFILE_GZIP;
+    if( ( len > 4 ) && ( strcmp(name + len - 4, ".zst") == 0 ) )
+        return CFILE_ZSTD;
+
+    return CFILE_PLAIN;
+    }
+
+
+/*  function        FILE * cfdopen( int fd, const char * mode, int kind )
+
+    brief           Makes a stdio stream of a file, (de)compressing as given
+                    by <kind>. The stream owns <fd>, fclose() closes it.
+
+    param[in]       int fd, the file
+    param[in]       const char * mode, "r", "w" or "a"
+    param[in]       int kind, CFILE_PLAIN, CFILE_GZIP or CFILE_ZSTD
+
+    return          FILE *, the stream, 0 on error (errno is set)
+*/
+FILE * cfdopen( int fd, const char * mode, int kind )
+    {
+    switch( kind )
+        {
+        case CFILE_GZIP:
+#ifdef HAVE_ZLIB
+            return _gz_open(fd, mode);
+#else
+            break;
+#endif  // HAVE_ZLIB
+        case CFILE_ZSTD:
+#ifdef HAVE_ZSTD
+            return _zstd_open(fd, mode);
+#else
+            break;
+#endif  // HAVE_ZSTD
+        default:
+            return fdopen(fd, mode);
+        }
+
+    debug("Built without support for compression %d\n", kind);
+    close(fd);
+    errno = ENOTSUP;
+
+    return 0;
+    }
+
+
+/*  function        static int _kind_of_fd( int fd )
+
+    brief           Returns the compression a file is written with, given
+                    by its first bytes.
+
+    param[in]       int fd, the file
+
+    return          int, CFILE_PLAIN, CFILE_GZIP or CFILE_ZSTD
+*/
+static int _kind_of_fd( int fd )
+    {
+    unsigned char magic[MAGIC_LEN];
+    ssize_t n;
+
+    n = pread(fd, magic, MAGIC_LEN, 0);
+    if( ( n >= (ssize_t)sizeof(gzip_magic) ) && ( memcmp(magic, gzip_magic, sizeof(gzip_magic)) == 0 ) )
+        return CFILE_GZIP;
+    if( ( n >= (ssize_t)sizeof(zstd_magic) ) && ( memcmp(magic, zstd_magic, sizeof(zstd_magic)) == 0 ) )
+        return CFILE_ZSTD;
+
+    return CFILE_PLAIN;
+    }
+
+
+/*  function        int cfile_kind_of_file( const char * name )
+
+    brief           Returns the compression a file is written with, given
+                    by its first bytes.
+
+    param[in]       const char * name, file name
+
+    return          int, CFILE_PLAIN, CFILE_GZIP or CFILE_ZSTD, -1 on error (errno is set)
+*/
+int cfile_kind_of_file( const char * name )
+    {
+    int kind;
+    int fd;
+
+    fd = open(name, O_RDONLY);
+    if( fd < 0 )
+        return -1;
+    kind = _kind_of_fd(fd);
+    close(fd);
+
+    return kind;
+    }
+
+
+/*  function        FILE * cfopen( const char * name, const char * mode )
+
+    brief           Opens a file like fopen(). A compressed file is
+                    decompressed while being read, a file whose name ends with
+                    ".gz" or ".zst" is compressed while being written.
+
+    param[in]       const char * name, file name
+    param[in]       const char * mode, "r", "w" or "a"
+
+    return          FILE *, the stream, 0 on error (errno is set)
+*/
+FILE * cfopen( const char * name, const char * mode )
+    {
+    int kind;
+    int fd;
+
+    if( *mode == 'r' )
+        {
+        fd = open(name, O_RDONLY);
+        if( fd < 0 )
+            return 0;
+        kind = _kind_of_fd(fd);
+        }
+    else
+        {
+        fd = open(name, O_WRONLY | O_CREAT | ( ( *mode == 'a' ) ? O_APPEND : O_TRUNC ), 0666);
+        if( fd < 0 )
+            return 0;
+        kind = cfile_kind_of_name(name);
+        }
+
+    return cfdopen(fd, mode, kind);
+    }
@@ -0,0 +1,313 @@
+/*
+    Copyright (C)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+    See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.
+    If not, see <http://www.gnu.org/licenses/>.
+
+    Klabautermann Software
+    Uwe Jantzen
+    Weingartener Straße 33
+    76297 Stutensee
+    Germany
+
+    file        columns.c
+
+    date        19.10.2026
+
+    author      Uwe Jantzen (jantzen@klabautermann-software.de)
+
+    brief       Records as columns
+
+    details     A record takes 21 bytes instead of the 72 bytes of a dataset, so
+                scans over the records of years touch a third of the memory.
+                The conversion to and from datasets is lossless.
+
+    project     glucotux
+    target      Linux
+    begin       03.03.2012
+
+    note
+
+    todo
+
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "errors.h"
+#include "utils.h"
+#include "astm.h"
+#include "columns.h"
+
+
+/*  function        int dictionary_code( dictionary * d, const char * name, unsigned char * code )
+
+    brief           Returns the code of a string, a string not known yet
+                    gets the next free code.
+
+    param[in/out]   dictionary * d, the column's dictionary
+    param[in]       const char * name, the string
+    param[out]      unsigned char * code, the string's code
+
+    return          int, error code
+*/
+int dictionary_code( dictionary * d, const char * name, unsigned char * code )
+    {
+    unsigned int i;
+    size_t len;
+
+    if( ( d->last < d->count ) && ( strncmp(d->names[d->last], name, COLUMN_NAME_LEN) == 0 ) )
+        {
+        *code = (unsigned char)d->last;
+        return NOERR;
+        }
+    for( i = 0; i < d->count; ++i )
+        {
+        if( strncmp(d->names[i], name, COLUMN_NAME_LEN) == 0 )
+            break;
+        }
+    if( i == d->count )
+        {
+        if( d->count >= COLUMN_CODES )
+            return ERR_TOO_MANY_CODES;
+        len = strnlen(name, COLUMN_NAME_LEN - 1);                               // cut to fit
+        memcpy(d->names[i], name, len);
+        d->names[i][len] = 0;
+        ++d->count;
+        }
+    d->last = i;
+    *code = (unsigned char)i;
+
+    return NOERR;
+    }
+
+
+/*  function        void dictionary_init( dictionary * d, const char * const * names, unsigned int count )
+
+    brief           Fills a dictionary with its fixed codes.
+
+    param[out]      dictionary * d, the dictionary
+    param[in]       const char * const * names, strings of the fixed codes
+    param[in]       unsigned int count, number of fixed codes
+*/
+void dictionary_init( dictionary * d, const char * const * names, unsigned int count )
+    {
+    unsigned char code;
+
+    d->count = 0;
+    d->last = 0;
+    while( d->count < count )
+        dictionary_code(d, names[d->count], &code);
+    }
+
+
+/*  function        static int _grow( columns * c, size_t capacity )
+
+    brief           Enlarges the columns to hold <capacity> records.
+
+    param[in/out]   columns * c, the columns
+    param[in]       size_t capacity, number of records
+
+    return          int, error code
+*/
+static int _grow( columns * c, size_t capacity )
+    {
+    void * p;
+
+    if( ( p = realloc(c->time, capacity * sizeof(long long)) ) == 0 )
+        return ERR_NOT_ENOUGH_MEMORY;
+    c->time = (long long *)p;
+    if( ( p = realloc(c->digits, capacity) ) == 0 )
+        return ERR_NOT_ENOUGH_MEMORY;
+    c->digits = (unsigned char *)p;
+    if( ( p = realloc(c->value, capacity * sizeof(int)) ) == 0 )
+        return ERR_NOT_ENOUGH_MEMORY;
+    c->value = (int *)p;
+    if( ( p = realloc(c->number, capacity * sizeof(int)) ) == 0 )
+        return ERR_NOT_ENOUGH_MEMORY;
+    c->number = (int *)p;
+    if( ( p = realloc(c->type, capacity) ) == 0 )
+        return ERR_NOT_ENOUGH_MEMORY;
+    c->type = (unsigned char *)p;
+    if( ( p = realloc(c->unit, capacity) ) == 0 )
+        return ERR_NOT_ENOUGH_MEMORY;
+    c->unit = (unsigned char *)p;
+    if( ( p = realloc(c->flags, capacity) ) == 0 )
+        return ERR_NOT_ENOUGH_MEMORY;
+    c->flags = (unsigned char *)p;
+    if( ( p = realloc(c->record_type, capacity) ) == 0 )
+        return ERR_NOT_ENOUGH_MEMORY;
+    c->record_type = (char *)p;
+    c->capacity = capacity;
+
+    return NOERR;
+    }
+
+
+/*  function        int columns_init( columns * c, size_t capacity )
+
+    brief           Initializes empty columns with space for <capacity>
+                    records, they grow as records are added.
+
+    param[out]      columns * c, the columns
+    param[in]       size_t capacity, number of records expected
+
+    return          int, error code
+*/
+int columns_init( columns * c, size_t capacity )
+    {
+    static const char * const types[] = { "Glucose", "Insulin", "Carb" };      // in the order of TYPE_...
+    static const char * const units[] = { "mg/dL", "mmol/L" };                  // in the order of UNIT_...
+    static const char * const flags[] = { "" };                                 // in the order of FLAGS_...
+    int result;
+    assert(c);
+
+    memset(c, 0, sizeof(columns));
+    dictionary_init(&c->types, types, sizeof(types) / sizeof(types[0]));
+    dictionary_init(&c->units, units, sizeof(units) / sizeof(units[0]));
+    dictionary_init(&c->flag_strings, flags, sizeof(flags) / sizeof(flags[0]));
+
+    result = _grow(c, capacity ? capacity : 1);
+    if( result )
+        columns_free(c);
+
+    return result;
+    }
+
+
+/*  function        void columns_free( columns * c )
+
+    brief           Frees the columns' memory.
+
+    param[in/out]   columns * c, the columns
+*/
+void columns_free( columns * c )
+    {
+    free(c->time);
+    free(c->digits);
+    free(c->value);
+    free(c->number);
+    free(c->type);
+    free(c->unit);
+    free(c->flags);
+    free(c->record_type);
+    memset(c, 0, sizeof(columns));
+    }
+
+
+/*  function        int columns_add( columns * c, const dataset * data )
+
+    brief           Appends a record to the columns.
+
+    param[in/out]   columns * c, the columns
+    param[in]       const dataset * data, the record
+
+    return          int, error code
+*/
+int columns_add( columns * c, const dataset * data )
+    {
+    size_t i = c->count;
+    int result;
+    assert(data);
+
+    if( i == c->capacity )
+        {
+        result = _grow(c, 2 * c->capacity);
+        if( result )
+            return result;
+        }
+
+    result = dictionary_code(&c->types, data->UTID, c->type + i);
+    if( result == NOERR )
+        result = dictionary_code(&c->units, data->unit, c->unit + i);
+    if( result == NOERR )
+        result = dictionary_code(&c->flag_strings, data->flags, c->flags + i);
+    if( result )
+        return result;
+    c->time[i] = data->time_key;
+    c->digits[i] = (unsigned char)strnlen(data->timestamp, sizeof(data->timestamp) - 1);
+    c->value[i] = data->result;
+    c->number[i] = data->record_number;
+    c->record_type[i] = data->record_type;
+    ++c->count;
+
+    return NOERR;
+    }
+
+
+/*  function        void columns_get( const columns * c, size_t i, dataset * data )
+
+    brief           Returns record <i> as a dataset.
+
+    param[in]       const columns * c, the columns
+    param[in]       size_t i, the record's index
+    param[out]      dataset * data, the record
+*/
+void columns_get( const columns * c, size_t i, dataset * data )
+    {
+    assert(i < c->count);
+
+    memset(data, 0, sizeof(dataset));
+    key_timestamp(data->timestamp, c->time[i], c->digits[i]);
+    data->time_key = c->time[i];
+    data->result = c->value[i];
+    data->record_number = c->number[i];
+    data->record_type = c->record_type[i];
+    memcpy(data->UTID, c->types.names[c->type[i]], sizeof(data->UTID) - 1);
+    memcpy(data->unit, c->units.names[c->unit[i]], sizeof(data->unit) - 1);
+    memcpy(data->flags, c->flag_strings.names[c->flags[i]], sizeof(data->flags) - 1);
+    }
+
+
+/*  function        int columns_from_datasets( columns * c, const dataset * data, size_t records )
+
+    brief           Appends an array of records to the columns.
+
+    param[in/out]   columns * c, the columns
+    param[in]       const dataset * data, the records
+    param[in]       size_t records, number of records
+
+    return          int, error code
+*/
+int columns_from_datasets( columns * c, const dataset * data, size_t records )
+    {
+    size_t i;
+    int result = NOERR;
+
+    if( c->count + records > c->capacity )
+        result = _grow(c, c->count + records);
+    for( i = 0; ( i < records ) && ( result == NOERR ); ++i )
+        result = columns_add(c, data + i);
+
+    return result;
+    }
+
+
+/*  function        void columns_to_datasets( const columns * c, dataset * data )
+
+    brief           Returns all records as datasets.
+
+    param[in]       const columns * c, the columns
+    param[out]      dataset * data, space for c->count records
+*/
+void columns_to_datasets( const columns * c, dataset * data )
+    {
+    size_t i;
+
+    for( i = 0; i < c->count; ++i )
+        columns_get(c, i, data + i);
+    }
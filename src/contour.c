@@ -23,13 +23,14 @@
 
     file        contour.c
 
-    date        11.11.2019
+    date        19.10.2026
 
     author      Uwe Jantzen (jantzen@klabautermann-software.de)
 
     brief       Handle the contour device
 
-    details
+    details     Everything that differs between the supported models is
+                kept in their profiles, selected once per session.
 
     project     glucotux
     target      Linux
@@ -54,6 +55,7 @@
 #include "globals.h"
 #include "debug.h"
 #include "utils.h"
+#include "progress.h"
 #include "contour.h"
 
 
@@ -64,17 +66,40 @@
 #define DEV_NAME                          "hiddev"
 
 
-static const short int device_codes[] =
+static const contour_profile profiles[] =                                       // a new model needs a new line only
     {
-    CONTOUR_USB_CODE,
-    CONTOUR_USB_NEXT_CODE,
-    CONTOUR_NEXT_ONE
+    //  product code            name                    ENQ     delay   H: prod count time  R: num  utid skip  res  unit  flags time len
+    { CONTOUR_USB_CODE,         "Contour USB",          TRUE,   5000,      4,    6,   13,      1,   2,   3,    3,   4,    6,    8,  12 },
+    { CONTOUR_USB_NEXT_CODE,    "Contour USB Next",     FALSE,  5000,      4,    6,   13,      1,   2,   3,    3,   4,    6,    8,  12 },
+    { CONTOUR_NEXT_ONE,         "Contour Next One",     FALSE,     0,      4,    6,   13,      1,   2,   3,    3,   4,    6,    8,  14 }
     };
 
 
 static unsigned int usage_code = 0;
 
 
+/*  function        const contour_profile * get_contour_profile( int contour_type )
+
+    brief           Returns the profile of a contour device.
+
+    param[in]       int contour_type, type of contour device
+
+    return          const contour_profile *, the profile, 0 if the type is unknown
+*/
+const contour_profile * get_contour_profile( int contour_type )
+    {
+    size_t i;
+
+    for( i = 0; i < (sizeof(profiles) / sizeof(profiles[0])); ++i )
+        {
+        if( profiles[i].product_code == contour_type )
+            return profiles + i;
+        }
+
+    return 0;
+    }
+
+
 /*  function        static int _open_contour( int * contour_type, int * handle )
 
     brief           Searches for a Bayer Contour USB device and if found returns
@@ -100,7 +125,7 @@ static int _open_contour( int * contour_type, int * handle )
         {
         snprintf(device, 256, "%s%s%d", CONTOUR_PATH, DEV_NAME, hiddev_num);
         debug("Try to open device %s\n", device);
-        rotating_bar();
+        progress_wait();
         *handle = open(device, O_RDWR);
         debug("handle : %d\n", *handle);
 
@@ -155,15 +180,10 @@ static int _open_contour( int * contour_type, int * handle )
 
         if( device_info.vendor == CONTOUR_USB_VENDOR_CODE )
             {
-            int i;
-
-            for( i = 0; i < (sizeof(device_codes) / sizeof(device_codes[0])); ++i )
+            if( get_contour_profile(device_info.product) )
                 {
-                if( device_info.product == device_codes[i] )
-                    {
-                    *contour_type = device_info.product;
-                    return NOERR;
-                    }
+                *contour_type = device_info.product;
+                return NOERR;
                 }
             }
         debug("Vendor and product doesn't match\n");
@@ -225,7 +245,7 @@ int wait_for_contour( int * contour_type, int * handle )
 
     do
         {
-        rotating_bar();
+        progress_wait();
         usleep(500 * 1000);
         result = _open_contour(contour_type, handle);
         if( result )
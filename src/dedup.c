@@ -0,0 +1,271 @@
+/*
+    Copyright (C)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+    See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.
+    If not, see <http://www.gnu.org/licenses/>.
+
+    Klabautermann Software
+    Uwe Jantzen
+    Weingartener Straße 33
+    76297 Stutensee
+    Germany
+
+    file        dedup.c
+
+    date        19.10.2026
+
+    author      Uwe Jantzen (jantzen@klabautermann-software.de)
+
+    brief       Set of records to find duplicates
+
+    details     An open addressing hash set of the records' contents : time key,
+                value and the codes of type, unit and flags. A record takes 16
+                bytes, the set is kept at most half full.
+                The slots in use are listed, so clearing the set costs the
+                number of records in it, not the number of slots.
+
+    project     glucotux
+    target      Linux
+    begin       03.03.2012
+
+    note
+
+    todo
+
+*/
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "errors.h"
+#include "globals.h"
+#include "astm.h"
+#include "columns.h"
+#include "dedup.h"
+
+
+#define MIN_SLOTS                           16
+
+
+/*  function        static size_t _hash( const record_key * key )
+
+    brief           Returns the hash of a record's contents.
+
+    param[in]       const record_key * key, the contents
+
+    return          size_t, the hash
+*/
+static size_t _hash( const record_key * key )
+    {
+    unsigned long long h;
+
+    h = (unsigned long long)key->time * 0x9e3779b97f4a7c15ULL;
+    h ^= ( (unsigned long long)(unsigned int)key->value << 24 ) ^ ( (unsigned long long)key->type << 16 )
+        ^ ( (unsigned long long)key->unit << 8 ) ^ key->flags;
+    h ^= h >> 31;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 29;
+
+    return (size_t)h;
+    }
+
+
+/*  function        static int _same( const record_key * a, const record_key * b )
+
+    brief           Compares the contents of two records.
+
+    param[in]       const record_key * a, first record
+    param[in]       const record_key * b, second record
+
+    return          int, TRUE if the contents are the same
+*/
+static int _same( const record_key * a, const record_key * b )
+    {
+    return ( a->time == b->time ) && ( a->value == b->value ) && ( a->type == b->type )
+        && ( a->unit == b->unit ) && ( a->flags == b->flags );
+    }
+
+
+/*  function        static record_key * _find( record_key * keys, size_t slots, const record_key * key )
+
+    brief           Returns the slot of a record or the empty slot to put it
+                    in, by linear probing.
+
+    param[in]       record_key * keys, the slots
+    param[in]       size_t slots, number of slots, a power of 2
+    param[in]       const record_key * key, the record's contents
+
+    return          record_key *, the slot
+*/
+static record_key * _find( record_key * keys, size_t slots, const record_key * key )
+    {
+    size_t i = _hash(key) & ( slots - 1 );
+
+    while( keys[i].used && !_same(keys + i, key) )
+        i = ( i + 1 ) & ( slots - 1 );
+
+    return keys + i;
+    }
+
+
+/*  function        static int _grow( record_set * set )
+
+    brief           Doubles the number of slots and puts the records in again.
+
+    param[in/out]   record_set * set, the set
+
+    return          int, error code
+*/
+static int _grow( record_set * set )
+    {
+    record_key * keys;
+    record_key * slot;
+    size_t * filled;
+    size_t slots = 2 * set->slots;
+    size_t i;
+
+    keys = (record_key *)calloc(slots, sizeof(record_key));
+    filled = (size_t *)malloc(( slots / 2 + 1 ) * sizeof(size_t));
+    if( ( keys == 0 ) || ( filled == 0 ) )
+        {
+        free(keys);
+        free(filled);
+        return ERR_NOT_ENOUGH_MEMORY;
+        }
+    for( i = 0; i < set->count; ++i )
+        {
+        slot = _find(keys, slots, set->keys + set->filled[i]);
+        *slot = set->keys[set->filled[i]];
+        filled[i] = (size_t)(slot - keys);
+        }
+    free(set->keys);
+    free(set->filled);
+    set->keys = keys;
+    set->filled = filled;
+    set->slots = slots;
+
+    return NOERR;
+    }
+
+
+/*  function        int record_set_init( record_set * set, size_t records )
+
+    brief           Initializes an empty set, it grows as records are added.
+
+    param[out]      record_set * set, the set
+    param[in]       size_t records, number of records expected
+
+    return          int, error code
+*/
+int record_set_init( record_set * set, size_t records )
+    {
+    assert(set);
+
+    memset(set, 0, sizeof(record_set));
+    for( set->slots = MIN_SLOTS; set->slots < 2 * records; set->slots *= 2 )
+        ;
+    set->keys = (record_key *)calloc(set->slots, sizeof(record_key));
+    set->filled = (size_t *)malloc(( set->slots / 2 + 1 ) * sizeof(size_t));
+    if( ( set->keys == 0 ) || ( set->filled == 0 ) )
+        {
+        record_set_free(set);
+        return ERR_NOT_ENOUGH_MEMORY;
+        }
+    dictionary_init(&set->types, 0, 0);
+    dictionary_init(&set->units, 0, 0);
+    dictionary_init(&set->flag_strings, 0, 0);
+
+    return NOERR;
+    }
+
+
+/*  function        void record_set_free( record_set * set )
+
+    brief           Frees the set's memory.
+
+    param[in/out]   record_set * set, the set
+*/
+void record_set_free( record_set * set )
+    {
+    free(set->keys);
+    free(set->filled);
+    memset(set, 0, sizeof(record_set));
+    }
+
+
+/*  function        void record_set_clear( record_set * set )
+
+    brief           Removes all records from the set, the slots are kept.
+                    Only the slots in use are emptied. The codes of the
+                    strings start anew too, so a set cleared often never
+                    runs out of codes.
+
+    param[in/out]   record_set * set, the set
+*/
+void record_set_clear( record_set * set )
+    {
+    size_t i;
+
+    for( i = 0; i < set->count; ++i )
+        set->keys[set->filled[i]].used = FALSE;
+    set->count = 0;
+    dictionary_init(&set->types, 0, 0);
+    dictionary_init(&set->units, 0, 0);
+    dictionary_init(&set->flag_strings, 0, 0);
+    }
+
+
+/*  function        int record_set_add( record_set * set, const dataset * data, int * added )
+
+    brief           Adds a record to the set if its contents are not in the
+                    set yet.
+
+    param[in/out]   record_set * set, the set
+    param[in]       const dataset * data, the record
+    param[out]      int * added, FALSE if the record is a duplicate
+
+    return          int, error code
+*/
+int record_set_add( record_set * set, const dataset * data, int * added )
+    {
+    record_key key;
+    record_key * slot;
+    int result;
+
+    *added = FALSE;
+    memset(&key, 0, sizeof(key));
+    key.time = data->time_key;
+    key.value = data->result;
+    key.used = TRUE;
+    result = dictionary_code(&set->types, data->UTID, &key.type);
+    if( result == NOERR )
+        result = dictionary_code(&set->units, data->unit, &key.unit);
+    if( result == NOERR )
+        result = dictionary_code(&set->flag_strings, data->flags, &key.flags);
+    if( result )
+        return result;
+
+    slot = _find(set->keys, set->slots, &key);
+    if( slot->used )
+        return NOERR;
+
+    *slot = key;
+    *added = TRUE;
+    set->filled[set->count] = (size_t)(slot - set->keys);
+    if( ++set->count * 2 > set->slots )
+        return _grow(set);
+
+    return NOERR;
+    }
@@ -68,9 +68,27 @@ static char * errors[] =
     "Data line does not contain the expected number of elements",
     "Not enough memory to store data",
     "Error when writing to a file",
-    "Number of input files out of range [0 .. 2]",
+    "Input file index out of range",
     "Unit string read from meter device is longer than expected",
-    "No output file name(s) given"
+    "No output file name(s) given",
+    "Unknown raw capture file format",
+    "Raw capture ends before the transfer is finished",
+    "Can not start a thread",
+    "Unknown contour device type",
+    "Error when accessing the record store",
+    "Built without SQLite, no record store available",
+    "Can not map the file into memory",
+    "Too many different types, units or flags for the column store",
+    "Not a valid .gtx file",
+    "Records written to a .gtx file must be sorted by time",
+    "Damaged manifest of the master history",
+    "Date must be given as YYYY[MM[DD[hh[mm[ss]]]]]",
+    "Filter not valid, see -h",
+    "Record filtered out",
+    "Progress file descriptor is not open",
+    "Serial number of the meter (-e) missing or too long",
+    "Records of a file are not sorted by time",
+    "Filters (-f, -u, -y, -k, -w) can't be used with -n"
     };
 
 
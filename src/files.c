@@ -31,6 +31,8 @@
 
     details     All data records are sorted in chronological order, oldest
                 record first, newest record last.
+                Files are opened with cfopen(), so any of them may be gzip
+                or zstd compressed.
 
     project     glucotux
     target      Linux
@@ -47,345 +49,2240 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "errors.h"
 #include "debug.h"
 #include "astm.h"
 #include "utils.h"
+#include "format.h"
+#include "cfile.h"
+#include "store.h"
+#include "dedup.h"
+#include "pool.h"
+#include "gtx.h"
+#include "master.h"
+#include "timeindex.h"
 #include "globals.h"
 #include "files.h"
 
 
-#define LINE_LEN                            48                                  // fits for older and current line format
-#define NUM_OF_ELEMENTS                      7                                  // maximum number of data elements stored in one line
-#define ELEMENT_LEN                         14                                  // element's maximum string length
+#define MIN_RECORDS                         1024                                // first size of a growing dataset array
+#define CSV_BLOCK_LEN                       65536                               // lines are collected and written in blocks
+#define MAX_TOKENS                           7                                  // maximum number of data elements stored in one line
+#define SAMPLE_LINES                        16                                  // lines sampled to find out a file's data order
+#define CHUNK_LEN                           (1024 * 1024)                       // smaller files are parsed by one thread
+#define MAX_CHUNKS                          256
+#define RUN_RECORD_HEAD                     18                                  // fixed part of a record in a run
+#define RUN_RECORD_LEN                      (RUN_RECORD_HEAD + 3 + 12 + 10 + 10)  // longest record in a run
+#define SORT_CHECK_LINES                    4096                                // lines checked for order before a merge
+#define MAX_RUNS                            64                                  // runs of a level kept, more are merged
+#define AVERAGE_LINE_LEN                    60                                  // bytes per line of a data file, about
+#define COMPRESSION_RATIO                   8                                   // bytes of text per compressed byte, about
+#define INGEST_MEMORY_SHARE                 4                                   // part of the memory a merge in memory may use
 
 
-/*  function        static int _get_num_of_records( FILE * f )
+typedef size_t (* formatter)( const dataset * data, char * buffer );
 
-    brief           Counts the number of lines lines in the data file.
+typedef struct sort_key_t                                                       // a record's time key and position
+    {
+    unsigned long long key;
+    size_t index;
+    } sort_key;
+
+typedef struct source_t                                                         // an input file of a merge
+    {
+    FILE * f;                                                                   // 0 if the records are in memory
+    char * line;
+    size_t line_len;
+    line_parser parse;
+    dataset * records;                                                          // records of an unsorted file, sorted
+    size_t count;
+    size_t next;
+    FILE * run;                                                                 // a sorted run in a temporary file
+    gtx g;                                                                      // a .gtx file
+    gtx_block block;                                                            // the .gtx file's block being read
+    dataset data;                                                               // the current record
+    int file;                                                                   // index of the input file
+    int level;                                                                  // a run : number of merges it went through
+    int check;                                                                  // order known for the first lines only
+    long long last_key;                                                         // time key of the record read before
+    } source;
+
+typedef struct chunk_t                                                          // lines of a file parsed by one job
+    {
+    const char * start;
+    const char * end;                                                           // behind the last line's '\n'
+    line_parser parse;
+    const record_filter * filter;
+    size_t lines;
+    size_t records;                                                             // records taken of the lines
+    dataset * data;                                                             // the chunk's part of the dataset array
+    int result;
+    } chunk;
+
+typedef struct run_t                                                            // records sorted by time
+    {
+    dataset * data;
+    size_t count;
+    } run;
+
+typedef struct ingest_t                                                         // files read by the threads of the pool
+    {
+    const char * const * names;
+    run * runs;                                                                 // runs of the current level of the merge tree
+    run * merged;                                                               // runs of the next level
+    int * results;                                                              // error codes of the jobs
+    } ingest;
+
+typedef struct writer_t                                                         // output of records, text or .gtx
+    {
+    FILE * f;                                                                   // 0 for a .gtx file
+    gtx_writer gtx;
+    int storing;                                                                // records go to the record store too
+    store st;
+    formatter format;
+    size_t fill;
+    char block[CSV_BLOCK_LEN];                                                  // lines are collected and written in blocks
+    } writer;
+
+typedef struct token_t                                                          // part of a line, not terminated
+    {
+    const char * start;
+    size_t len;
+    } token;
+
+
+/*  function        static int _tokenize( const char * p, const char * end, token * tokens )
+
+    brief           Splits a line into its tokens, separated by blanks.
+
+    param[in]       const char * p, start of the line
+    param[in]       const char * end, end of the line
+    param[out]      token * tokens, MAX_TOKENS tokens
+
+    return          int, number of tokens, MAX_TOKENS + 1 if there are more
+*/
+static int _tokenize( const char * p, const char * end, token * tokens )
+    {
+    int n = 0;
+
+    while( 1 )
+        {
+        while( ( p < end ) && ( ( *p == ' ' ) || ( *p == '\t' ) || ( *p == '\r' ) || ( *p == '\n' ) ) )
+            ++p;
+        if( p == end )
+            break;
+        if( n == MAX_TOKENS )
+            return MAX_TOKENS + 1;
+        tokens[n].start = p;
+        while( ( p < end ) && ( *p != ' ' ) && ( *p != '\t' ) && ( *p != '\r' ) && ( *p != '\n' ) )
+            ++p;
+        tokens[n].len = (size_t)(p - tokens[n].start);
+        ++n;
+        }
+
+    return n;
+    }
+
+
+/*  function        static size_t _number( const token * t, int * value )
+
+    brief           Converts the leading decimal number of a token, like
+                    sscanf("%d").
+
+    param[in]       const token * t, the token
+    param[out]      int * value, the number, unchanged if there is none
+
+    return          size_t, number of characters used, 0 if there is no number
+*/
+static size_t _number( const token * t, int * value )
+    {
+    const char * p = t->start;
+    const char * end = t->start + t->len;
+    int negative = FALSE;
+    int n = 0;
+
+    if( ( p < end ) && ( ( *p == '-' ) || ( *p == '+' ) ) )
+        negative = ( *p++ == '-' );
+    if( ( p == end ) || ( *p < '0' ) || ( *p > '9' ) )
+        return 0;
+    for( ; ( p < end ) && ( *p >= '0' ) && ( *p <= '9' ); ++p )
+        n = n * 10 + (*p - '0');
+    *value = negative ? -n : n;
+
+    return (size_t)(p - t->start);
+    }
+
+
+/*  function        static void _copy( char * dst, size_t size, const token * t )
+
+    brief           Copies a token into a string, cut to fit <size>.
+
+    param[out]      char * dst, the string, '\0' terminated
+    param[in]       size_t size, size of dst
+    param[in]       const token * t, the token
+*/
+static void _copy( char * dst, size_t size, const token * t )
+    {
+    size_t len = ( t->len < size ) ? t->len : size - 1;
+
+    memcpy(dst, t->start, len);
+    dst[len] = 0;
+    }
+
+
+/*  function        int parse_old( dataset * data, const char * line, size_t len, const record_filter * filter )
+
+    brief           Parses a line of the data order used before 30.3.2018 :
+                    R <record number> <test id> <timestamp> <value><unit> <flag>
+                    The line needs no terminating '\0'.
+                    A record not passing the filter is not made, only its
+                    time key is set.
+
+    param[out]      dataset * data, store the data read in here
+    param[in]       const char * line, the line
+    param[in]       size_t len, the line's length
+    param[in]       const record_filter * filter, records to take, 0 : all
+
+    return          int, error code, ERR_FILTERED if the record is not taken
+*/
+int parse_old( dataset * data, const char * line, size_t len, const record_filter * filter )
+    {
+    token tokens[MAX_TOKENS];
+    token unit;
+    size_t used;
+    long long key;
+    int value = 0;
+
+    if( _tokenize(line, line + len, tokens) != 6 )
+        {
+        memset(data, 0, sizeof(dataset));
+        return ERR_NUM_OF_DATA_IN_LINE;
+        }
+
+    key = timestamp_key(tokens[3].start);                                       // cheap checks first
+    used = _number(tokens + 4, &value);
+    if( filter && ( !filter_time(filter, key) || !filter_type(filter, *tokens[2].start)
+            || !filter_markers(filter, tokens[5].start, 1) || !filter_value(filter, value) ) )
+        {
+        data->time_key = key;
+        return ERR_FILTERED;
+        }
+
+    memset(data, 0, sizeof(dataset));
+    data->record_type = *tokens[0].start;
+    _number(tokens + 1, &data->record_number);
+    _copy(data->UTID, sizeof(data->UTID), tokens + 2);
+    _copy(data->timestamp, sizeof(data->timestamp), tokens + 3);
+    data->time_key = key;
+    data->result = value;
+    unit.start = tokens[4].start + used;                                        // value and unit are one token
+    unit.len = tokens[4].len - used;
+    _copy(data->unit, sizeof(data->unit), &unit);
+    data->flags[0] = *tokens[5].start;
+
+    return NOERR;
+    }
+
+
+/*  function        static int _value( const token * t, char utid )
+
+    brief           Converts the value of a record, insulin has one decimal
+                    and is given in tenths of units. The sign is applied to
+                    the combined number, so "-0.5" gives -5.
+
+    param[in]       const token * t, the value's token
+    param[in]       char utid, first letter of the test id
+
+    return          int, the value
+*/
+static int _value( const token * t, char utid )
+    {
+    token digits = *t;
+    token decimal;
+    int negative = FALSE;
+    int value = 0;
+    int tenths = 0;
+    size_t used;
+
+    if( ( digits.len > 0 ) && ( ( *digits.start == '-' ) || ( *digits.start == '+' ) ) )
+        {
+        negative = ( *digits.start == '-' );
+        ++digits.start;
+        --digits.len;
+        }
+    used = _number(&digits, &value);
+    if( ( used == 0 ) || ( *digits.start < '0' ) || ( *digits.start > '9' ) )
+        return 0;
+    if( ( ( utid == 'I' ) || ( utid == 'W' ) ) && ( used < digits.len ) && ( digits.start[used] == '.' ) )
+        {
+        decimal.start = digits.start + used + 1;
+        decimal.len = digits.len - used - 1;
+        if( ( decimal.len > 0 ) && ( *decimal.start >= '0' ) && ( *decimal.start <= '9' ) && _number(&decimal, &tenths) )
+            value = value * 10 + tenths;
+        }
+
+    return negative ? -value : value;
+    }
+
+
+/*  function        int parse_current( dataset * data, const char * line, size_t len, const record_filter * filter )
+
+    brief           Parses a line of the current data order :
+                    <timestamp> <value> <unit> [<flags>] <test id> <record type> <record number>
+                    The line needs no terminating '\0'.
+                    A record not passing the filter is not made, only its
+                    time key is set.
+
+    param[out]      dataset * data, store the data read in here
+    param[in]       const char * line, the line
+    param[in]       size_t len, the line's length
+    param[in]       const record_filter * filter, records to take, 0 : all
+
+    return          int, error code, ERR_FILTERED if the record is not taken
+*/
+int parse_current( dataset * data, const char * line, size_t len, const record_filter * filter )
+    {
+    token tokens[MAX_TOKENS];
+    const token * utid;
+    long long key;
+    int value;
+    int n;
+    int i = 3;
+
+    n = _tokenize(line, line + len, tokens);
+    if( ( n != 6 ) && ( n != 7 ) )
+        {
+        memset(data, 0, sizeof(dataset));
+        return ERR_NUM_OF_DATA_IN_LINE;
+        }
+    utid = tokens + n - 3;
+
+    key = timestamp_key(tokens[0].start);                                       // cheap checks first
+    if( filter && ( !filter_time(filter, key) || !filter_type(filter, *utid->start)
+            || !filter_markers(filter, tokens[3].start, ( n == 7 ) ? tokens[3].len : 0) ) )
+        {
+        data->time_key = key;
+        return ERR_FILTERED;
+        }
+    value = _value(tokens + 1, *utid->start);
+    if( filter && !filter_value(filter, value) )
+        {
+        data->time_key = key;
+        return ERR_FILTERED;
+        }
+
+    memset(data, 0, sizeof(dataset));
+    _copy(data->timestamp, sizeof(data->timestamp), tokens);
+    data->time_key = key;
+    data->result = value;
+    _copy(data->unit, sizeof(data->unit), tokens + 2);
+    if( n == 7 )
+        _copy(data->flags, sizeof(data->flags), tokens + i++);
+    _copy(data->UTID, sizeof(data->UTID), tokens + i++);
+    data->record_type = *tokens[i++].start;
+    _number(tokens + i, &data->record_number);
+
+    return NOERR;
+    }
+
+
+/*  function        static line_parser _detect_layout( const char * text, size_t size )
+
+    brief           Finds out the data order of a file by sampling its first
+                    SAMPLE_LINES lines : lines of the old data order start
+                    with the record type 'R', lines of the current one with
+                    the timestamp. The majority wins.
+
+    param[in]       const char * text, start of the file
+    param[in]       size_t size, number of bytes available
+
+    return          line_parser, the parser for the whole file
+*/
+static line_parser _detect_layout( const char * text, size_t size )
+    {
+    const char * end = text + size;
+    const char * p = text;
+    int old = 0;
+    int current = 0;
+
+    while( ( p < end ) && ( old + current < SAMPLE_LINES ) )
+        {
+        while( ( p < end ) && ( ( *p == ' ' ) || ( *p == '\t' ) || ( *p == '\r' ) || ( *p == '\n' ) ) )
+            ++p;
+        if( p == end )
+            break;
+        if( *p == 'R' )
+            ++old;
+        else
+            ++current;
+        p = memchr(p, '\n', (size_t)(end - p));
+        if( p == 0 )
+            break;
+        }
+    debug("Layout sampled : %d old, %d current lines\n", old, current);
+
+    return ( old > current ) ? parse_old : parse_current;
+    }
+
+
+/*  function        static int _detect_stream_layout( FILE * f, line_parser * parse )
+
+    brief           Finds out the data order of a file being read as a
+                    stream by sampling its first SAMPLE_LINES lines, see
+                    _detect_layout(). The stream is rewound to its start.
+
+    param[in/out]   FILE * f, the stream, at its start
+    param[out]      line_parser * parse, the parser for the whole file
+
+    return          int, error code
+*/
+static int _detect_stream_layout( FILE * f, line_parser * parse )
+    {
+    char sample[SAMPLE_LINES * FORMAT_LINE_LEN];
+    size_t size = 0;
+    int lines = 0;
+
+    while( ( lines < SAMPLE_LINES ) && ( size < sizeof(sample) - 1 )
+        && fgets(sample + size, (int)( sizeof(sample) - size ), f) )
+        {
+        size += strlen(sample + size);
+        if( sample[size - 1] == '\n' )
+            ++lines;
+        }
+    *parse = _detect_layout(sample, size);
+
+    return ( fseeko(f, 0, SEEK_SET) == 0 ) ? NOERR : errno;
+    }
+
+
+/*  function        static int _sort_records( dataset * data, size_t records )
+
+    brief           Sorts records by time, records of the same time keep
+                    their order. Nothing is done if they are sorted already,
+                    else the time keys are sorted by an LSD radix sort, one
+                    byte per pass. Passes where all keys have the same byte
+                    are skipped, so a key YYYYMMDDhhmmss takes 6 passes at
+                    most.
+
+    param[in/out]   dataset * data, the records
+    param[in]       size_t records, number of records
+
+    return          int, error code
+*/
+static int _sort_records( dataset * data, size_t records )
+    {
+    sort_key * keys;
+    sort_key * temp;
+    sort_key * swap;
+    dataset * sorted;
+    size_t count[256];
+    size_t sum;
+    size_t i;
+    int shift;
+    int byte;
+
+    for( i = 1; ( i < records ) && ( data[i - 1].time_key <= data[i].time_key ); ++i )
+        ;
+    if( i >= records )
+        return NOERR;                                                           // already in order
+    debug("Sorting %lu records\n", records);
+
+    keys = (sort_key *)malloc(2 * records * sizeof(sort_key));
+    sorted = (dataset *)malloc(records * sizeof(dataset));
+    if( ( keys == 0 ) || ( sorted == 0 ) )
+        {
+        free(keys);
+        free(sorted);
+        return ERR_NOT_ENOUGH_MEMORY;
+        }
+    temp = keys + records;
+    for( i = 0; i < records; ++i )
+        {
+        keys[i].key = (unsigned long long)data[i].time_key;
+        keys[i].index = i;
+        }
+
+    for( shift = 0; shift < 64; shift += 8 )
+        {
+        memset(count, 0, sizeof(count));
+        for( i = 0; i < records; ++i )
+            ++count[(keys[i].key >> shift) & 0xff];
+        if( count[(keys[0].key >> shift) & 0xff] == records )
+            continue;                                                           // all keys have the same byte here
+        for( byte = 0, sum = 0; byte < 256; ++byte )
+            {
+            sum += count[byte];
+            count[byte] = sum - count[byte];                                    // first position of this byte
+            }
+        for( i = 0; i < records; ++i )
+            temp[count[(keys[i].key >> shift) & 0xff]++] = keys[i];
+        swap = keys;
+        keys = temp;
+        temp = swap;
+        }
+
+    for( i = 0; i < records; ++i )
+        sorted[i] = data[keys[i].index];
+    memcpy(data, sorted, records * sizeof(dataset));
+
+    free(( keys < temp ) ? keys : temp);                                        // the start of the allocation
+    free(sorted);
+
+    return NOERR;
+    }
+
+
+/*  function        static const record_filter * _filter( void )
+
+    brief           Returns the filter the parsers check, if one is set.
+
+    return          const record_filter *, the filter, 0 : all records are taken
+*/
+static const record_filter * _filter( void )
+    {
+    return is_filter() ? get_filter() : 0;
+    }
+
+
+/*  function        static void _count_chunk( void * arg, int job )
+
+    brief           Counts the lines of a chunk, a job of the pool.
+
+    param[in/out]   void * arg, the chunks
+    param[in]       int job, number of the chunk
+*/
+static void _count_chunk( void * arg, int job )
+    {
+    chunk * c = (chunk *)arg + job;
+    const char * p;
+    const char * eol;
+
+    c->lines = 0;
+    for( p = c->start; ( p < c->end ) && ( ( eol = memchr(p, '\n', (size_t)(c->end - p)) ) != 0 ); p = eol + 1 )
+        ++c->lines;
+    if( p < c->end )                                                            // last line without '\n'
+        ++c->lines;
+    }
+
+
+/*  function        static void _parse_chunk( void * arg, int job )
+
+    brief           Parses the lines of a chunk into its part of the dataset
+                    array, a job of the pool. Records filtered out leave no
+                    gap.
+
+    param[in/out]   void * arg, the chunks
+    param[in]       int job, number of the chunk
+*/
+static void _parse_chunk( void * arg, int job )
+    {
+    chunk * c = (chunk *)arg + job;
+    dataset * data = c->data;
+    const char * p;
+    const char * eol;
+
+    c->result = NOERR;
+    for( p = c->start; ( p < c->end ) && ( c->result == NOERR ); p = eol + 1 )
+        {
+        eol = memchr(p, '\n', (size_t)(c->end - p));
+        if( eol == 0 )
+            eol = c->end;
+        c->result = c->parse(data, p, (size_t)(eol - p), c->filter);
+        if( c->result == ERR_FILTERED )
+            c->result = NOERR;
+        else
+            ++data;
+        }
+    c->records = (size_t)(data - c->data);
+    }
+
+
+/*  function        static int _map_file( int fd, size_t size, dataset ** p_data, size_t * records )
+
+    brief           Maps a file into memory and parses the lines straight
+                    from the mapping. A large file is split into chunks at
+                    line ends, the lines of all chunks are counted and then
+                    parsed by the threads of the pool, each chunk into its
+                    part of the dataset array.
+
+    param[in]       int fd, the file's descriptor
+    param[in]       size_t size, the file's size
+    param[out]      dataset ** p_data, pointer to dataset array
+    param[out]      size_t * records, number of records in the dataset array
+
+    return          int, error code, ERR_MAP_FILE if the file can't be mapped
+*/
+static int _map_file( int fd, size_t size, dataset ** p_data, size_t * records )
+    {
+    int error = NOERR;
+    const char * text;
+    const char * end;
+    const char * p;
+    size_t lines = 0;
+    dataset * data;
+    line_parser parse;
+    chunk chunks[MAX_CHUNKS];
+    int num_chunks;
+    int i;
+
+    text = (const char *)mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if( text == MAP_FAILED )
+        return ERR_MAP_FILE;
+    madvise((void *)text, size, MADV_SEQUENTIAL);
+    end = text + size;
+    parse = _detect_layout(text, size);
+
+    num_chunks = ( size < 2 * CHUNK_LEN ) ? 1 : 4 * pool_threads();          // more chunks than threads balance the load
+    if( num_chunks > MAX_CHUNKS )
+        num_chunks = MAX_CHUNKS;
+    for( i = 0, p = text; i < num_chunks; ++i )
+        {
+        chunks[i].start = p;
+        p = ( i == num_chunks - 1 ) ? end : text + size / (size_t)num_chunks * (size_t)(i + 1);
+        if( p < chunks[i].start )
+            p = chunks[i].start;
+        while( ( p < end ) && ( p > text ) && ( p[-1] != '\n' ) )             // a chunk ends after a line
+            ++p;
+        chunks[i].end = p;
+        chunks[i].parse = parse;
+        chunks[i].filter = _filter();
+        }
+    pool_run(num_chunks, _count_chunk, chunks);
+    for( i = 0; i < num_chunks; ++i )
+        lines += chunks[i].lines;
+
+    data = (dataset *)malloc(( lines ? lines : 1 ) * sizeof(dataset));
+    *p_data = data;
+    if( data == 0 )
+        {
+        munmap((void *)text, size);
+        return ERR_NOT_ENOUGH_MEMORY;
+        }
+
+    for( i = 0; i < num_chunks; ++i )
+        {
+        chunks[i].data = data;
+        data += chunks[i].lines;
+        }
+    pool_run(num_chunks, _parse_chunk, chunks);
+    for( i = 0, lines = 0; ( i < num_chunks ) && ( error == NOERR ); ++i )
+        {
+        error = chunks[i].result;                                               // the first error of the file
+        if( chunks[i].data != *p_data + lines )                                 // close the gap of records filtered out
+            memmove(*p_data + lines, chunks[i].data, chunks[i].records * sizeof(dataset));
+        lines += chunks[i].records;
+        }
+    *records = lines;
+
+    munmap((void *)text, size);
+
+    return error;
+    }
+
+
+/*  function        static int _read_file( FILE * f, dataset ** p_data, size_t * records )
+
+    brief           Reads a file that can't be mapped (a pipe, a compressed
+                    file) line by line in one pass, the dataset array grows
+                    by doubling its size.
+
+    param[in]       FILE * f, file handle
+    param[out]      dataset ** p_data, pointer to dataset array
+    param[out]      size_t * records, number of records in the dataset array
+
+    return          int, error code
+*/
+static int _read_file( FILE * f, dataset ** p_data, size_t * records )
+    {
+    int error = NOERR;
+    char * line = 0;
+    size_t len = 0;
+    ssize_t n;
+    size_t size = MIN_RECORDS;
+    dataset * data;
+    line_parser parse = 0;
+    const record_filter * filter = _filter();
+
+    *records = 0;
+    data = (dataset *)malloc(size * sizeof(dataset));
+    *p_data = data;
+    if( data == 0 )
+        return ERR_NOT_ENOUGH_MEMORY;
+    error = _detect_stream_layout(f, &parse);
+
+    while( ( error == NOERR ) && ( ( n = getline(&line, &len, f) ) != -1 ) )                              // getline allocates memory for "line"
+        {
+        if( *records == size )
+            {
+            size *= 2;
+            data = (dataset *)realloc(*p_data, size * sizeof(dataset));
+            if( data == 0 )
+                {
+                error = ERR_NOT_ENOUGH_MEMORY;
+                break;
+                }
+            *p_data = data;
+            }
+        error = parse(*p_data + *records, line, (size_t)n, filter);
+        if( error == ERR_FILTERED )
+            error = NOERR;
+        else if( error )
+            break;
+        else
+            ++*records;
+        }
+
+    free(line);
+
+    return error;
+    }
+
+
+/*  function        static int _getfile( FILE * f, dataset ** p_data, size_t * records )
+
+    brief           Get a file, allocate enough memory and read the data
+                    into an array of type dataset sorted by time.
+                    A regular file is mapped into memory, other files are
+                    read through stdio, both in a single pass.
+                    On error p_data and/or the array contents are undefined.
+                    --- You have to free the memory elsewhere ---
+
+    param[in]       FILE * f, file handle
+    param[out]      dataset ** p_data, pointer to dataset array
+    param[out]      size_t * records, number of records in the dataset array
+
+    return          int, error code
+*/
+static int _getfile( FILE * f, dataset ** p_data, size_t * records )
+    {
+    int error = ERR_MAP_FILE;
+    struct stat st;
+    int fd;
+    assert(f);
+
+    *p_data = 0;
+    *records = 0;
+    fd = fileno(f);                                                             // -1 for a decompressing stream
+    if( ( fd >= 0 ) && ( fstat(fd, &st) == 0 ) && S_ISREG(st.st_mode) && ( st.st_size > 0 ) )
+        error = _map_file(fd, (size_t)st.st_size, p_data, records);
+    if( error == ERR_MAP_FILE )
+        {
+        free(*p_data);
+        error = _read_file(f, p_data, records);
+        }
+    debug("Records found %lu\n", *records);
+
+    if( error == NOERR )
+        error = _sort_records(*p_data, *records);
+
+showerr(error);
+    return error;
+    }
+
+
+/*  function        static int _load_gtx( const char *infile_name, dataset ** p_data, size_t * records )
+
+    brief           Reads all records of a .gtx file.
+                    --- You have to free the memory elsewhere ---
+
+    param[in]       const char *infile_name, name of the file to read from
+    param[out]      dataset ** p_data, pointer to dataset array
+    param[out]      size_t * records, number of records in the dataset array
+
+    return          int, error code
+*/
+static int _load_gtx( const char *infile_name, dataset ** p_data, size_t * records )
+    {
+    gtx g;
+    gtx_block block;
+    dataset * data;
+    const record_filter * filter = _filter();
+    size_t b;
+    size_t i;
+    int result;
+
+    *p_data = 0;
+    *records = 0;
+    result = gtx_open(&g, infile_name);
+    if( result )
+        return result;
+
+    data = (dataset *)malloc(( gtx_records(&g) + 1 ) * sizeof(dataset));
+    *p_data = data;
+    if( data == 0 )
+        result = ERR_NOT_ENOUGH_MEMORY;
+    for( b = 0; ( b < g.header->blocks ) && ( result == NOERR ); ++b )
+        {
+        gtx_get_block(&g, b, &block);
+        for( i = 0; i < block.count; ++i )
+            {
+            gtx_get(&g, &block, i, data);
+            if( ( filter == 0 ) || filter_record(filter, data) )
+                ++data;
+            }
+        }
+    if( result == NOERR )
+        *records = (size_t)(data - *p_data);
+
+    gtx_close(&g);
+    return result;
+    }
+
+
+/*  function        static int _load( const char *infile_name, dataset ** p_data, size_t * records )
+
+    brief           Reads all records of a data file or a .gtx file sorted
+                    by time.
+                    --- You have to free the memory elsewhere ---
+
+    param[in]       const char *infile_name, name of the file to read from
+    param[out]      dataset ** p_data, pointer to dataset array
+    param[out]      size_t * records, number of records in the dataset array
+
+    return          int, error code
+*/
+static int _load( const char *infile_name, dataset ** p_data, size_t * records )
+    {
+    FILE * infile;
+    int result;
+
+    *p_data = 0;
+    *records = 0;
+    if( gtx_is_file(infile_name) )
+        return _load_gtx(infile_name, p_data, records);
+
+    infile = cfopen(infile_name, "r");
+    if( infile == 0 )
+        return errno;
+    result = _getfile(infile, p_data, records);
+    fclose(infile);
+
+    return result;
+    }
+
+
+/*  function        static int _writer_open( writer * w, const char *outfile_name, formatter format )
+
+    brief           Opens the output of records. A name ending in .gtx gives
+                    a .gtx file, else lines in the format given are written,
+                    to stdout if no <outfile_name> is given.
+                    With a record store (-q) the records are stored too, for
+                    the meter given by -e.
+
+    param[out]      writer * w, the output
+    param[in]       const char *outfile_name, name of the file to write to
+    param[in]       formatter format, formats one line
+
+    return          int, error code
+*/
+static int _writer_open( writer * w, const char *outfile_name, formatter format )
+    {
+    int result;
+
+    w->f = 0;
+    w->format = format;
+    w->fill = 0;
+    w->storing = ( *get_store_name() != 0 );
+    if( w->storing )
+        {
+        if( *get_meter_name() == 0 )
+            return ERR_METER_NAME;
+        result = store_open(&w->st, get_store_name());
+        if( result )
+            return result;
+        store_set_meter(&w->st, get_meter_name());
+        }
+
+    if( gtx_is_name(outfile_name) )
+        {
+        result = gtx_create(&w->gtx, outfile_name);
+        if( result && w->storing )
+            store_close(&w->st, FALSE);
+        return result;
+        }
+
+    w->gtx.f = 0;
+    w->f = ( *outfile_name ) ? cfopen(outfile_name, "w") : stdout;
+    if( w->f == 0 )
+        {
+        result = errno;
+        if( w->storing )
+            store_close(&w->st, FALSE);
+        return result;
+        }
+
+    return NOERR;
+    }
+
+
+/*  function        static int _writer_put( writer * w, const dataset * data )
+
+    brief           Writes a record. Lines are collected in a block that is
+                    written when it is full.
+
+    param[in/out]   writer * w, the output
+    param[in]       const dataset * data, the record
+
+    return          int, error code
+*/
+static int _writer_put( writer * w, const dataset * data )
+    {
+    int result;
+
+    if( w->storing )
+        {
+        result = store_add(&w->st, data);
+        if( result )
+            return result;
+        }
+    if( w->f == 0 )
+        return gtx_write(&w->gtx, data);
+
+    w->fill += w->format(data, w->block + w->fill);
+    if( w->fill > CSV_BLOCK_LEN - FORMAT_LINE_LEN )                             // no room for another line
+        {
+        if( fwrite(w->block, 1, w->fill, w->f) != w->fill )
+            return ERR_WRITE_TO_FILE;
+        w->fill = 0;
+        }
+
+    return NOERR;
+    }
+
+
+/*  function        static int _writer_close( writer * w, int result )
+
+    brief           Writes what is left and closes the output. The records
+                    stored are committed only if there was no error.
+
+    param[in/out]   writer * w, the output
+    param[in]       int result, error code so far
+
+    return          int, error code
+*/
+static int _writer_close( writer * w, int result )
+    {
+    int store_result;
+
+    if( w->f == 0 )
+        result = gtx_finish(&w->gtx, result);
+    else
+        {
+        if( ( result == NOERR ) && ( fwrite(w->block, 1, w->fill, w->f) != w->fill ) )
+            result = ERR_WRITE_TO_FILE;
+        if( w->f != stdout )
+            {
+            if( ( fclose(w->f) != 0 ) && ( result == NOERR ) )                  // a compressed file is finished here
+                result = ERR_WRITE_TO_FILE;
+            }
+        else if( ( fflush(stdout) != 0 ) && ( result == NOERR ) )
+            result = ERR_WRITE_TO_FILE;
+        w->f = 0;
+        }
+
+    if( w->storing )
+        {
+        store_result = store_close(&w->st, result == NOERR);
+        if( result == NOERR )
+            result = store_result;
+        w->storing = FALSE;
+        }
+
+    return result;
+    }
+
+
+/*  function        static int _is_sorted( const char *infile_name, size_t lines, int * sorted )
+
+    brief           Reads the first <lines> lines of a file to find out if
+                    its records are in the order of time already.
+
+    param[in]       const char *infile_name, name of the file to read from
+    param[in]       size_t lines, number of lines to check, 0 : all
+    param[out]      int * sorted, TRUE if the records checked are in order
+
+    return          int, error code
+*/
+static int _is_sorted( const char *infile_name, size_t lines, int * sorted )
+    {
+    int result = NOERR;
+    FILE * infile;
+    char * line = 0;
+    size_t line_len = 0;
+    ssize_t n;
+    dataset data;
+    long long last = 0;
+    line_parser parse = 0;
+
+    *sorted = TRUE;
+    infile = cfopen(infile_name, "r");
+    if( infile == 0 )
+        return errno;
+    result = _detect_stream_layout(infile, &parse);
+
+    while( ( result == NOERR ) && ( ( n = getline(&line, &line_len, infile) ) != -1 ) )                    // getline allocates memory for "line"
+        {
+        result = parse(&data, line, (size_t)n, 0);
+        if( result )
+            break;
+        if( data.time_key < last )
+            {
+            *sorted = FALSE;
+            break;
+            }
+        last = data.time_key;
+        if( --lines == 0 )                                                      // 0 wraps around and reads all
+            break;
+        }
+
+    free(line);
+    fclose(infile);
+    return result;
+    }
+
+
+/*  function        static int _index_file( const char *infile_name, time_index * idx )
+
+    brief           Brings the time index of an uncompressed data file up to
+                    date : if the last line indexed is still where it was,
+                    only the lines behind it are read, else the index is
+                    made anew. The index is saved if it changed, a data file
+                    in a directory not writable is indexed every time.
+
+    param[in]       const char *infile_name, name of the data file
+    param[out]      time_index * idx, the index
+
+    return          int, error code
+*/
+static int _index_file( const char *infile_name, time_index * idx )
+    {
+    int result;
+    FILE * infile;
+    char * line = 0;
+    size_t line_len = 0;
+    ssize_t n;
+    dataset data;
+    line_parser parse = 0;
+    uint64_t offset;
+    uint64_t covered;
+
+    result = time_index_load(idx, infile_name);
+    if( result )
+        return result;
+    infile = fopen(infile_name, "r");
+    if( infile == 0 )
+        return errno;
+
+    if( _detect_stream_layout(infile, &parse) != NOERR )
+        parse = 0;
+    if( parse && idx->covered && ( fseeko(infile, (off_t)idx->last_offset, SEEK_SET) == 0 ) )
+        {
+        n = getline(&line, &line_len, infile);
+        if( ( n <= 0 ) || ( idx->last_offset + (uint64_t)n != idx->covered )
+            || ( parse(&data, line, (size_t)n, 0) != NOERR ) || ( data.time_key != idx->last_key ) )
+            {
+            debug("%s changed, index made anew\n", infile_name);
+            time_index_free(idx);
+            }
+        }
+    covered = idx->covered;
+
+    offset = idx->covered;
+    if( idx->sorted && parse && ( fseeko(infile, (off_t)offset, SEEK_SET) == 0 ) )
+        {
+        while( ( n = getline(&line, &line_len, infile) ) != -1 )                // getline allocates memory for "line"
+            {
+            if( line[n - 1] != '\n' )                                          // being written
+                break;
+            result = parse(&data, line, (size_t)n, 0);
+            if( result == NOERR )
+                result = time_index_add(idx, data.time_key, offset);
+            if( result || !idx->sorted )
+                break;
+            offset += (uint64_t)n;
+            idx->covered = offset;
+            }
+        }
+    debug("%s : %lu days indexed, %lu new bytes\n", infile_name, idx->count, idx->covered - covered);
+
+    if( ( result == NOERR ) && ( ( idx->covered != covered ) || !idx->sorted ) )
+        {
+        if( time_index_save(idx, infile_name) != NOERR )
+            debug("%s : index not saved\n", infile_name);
+        }
+
+    free(line);
+    fclose(infile);
+    return result;
+    }
+
+
+/*  function        static source * _add_source( source ** sources, int * count, int * capacity )
+
+    brief           Adds an empty input to the inputs of a merge.
+
+    param[in/out]   source ** sources, the inputs, grows as needed
+    param[in/out]   int * count, number of inputs
+    param[in/out]   int * capacity, number of inputs space is allocated for
+
+    return          source *, the new input, 0 if out of memory
+*/
+static source * _add_source( source ** sources, int * count, int * capacity )
+    {
+    source * p;
+
+    if( *count == *capacity )
+        {
+        p = (source *)realloc(*sources, (size_t)(*capacity + 16) * sizeof(source));
+        if( p == 0 )
+            return 0;
+        *sources = p;
+        *capacity += 16;
+        }
+    p = *sources + (*count)++;
+    memset(p, 0, sizeof(source));
+
+    return p;
+    }
+
+
+/*  function        static int _write_run_record( FILE * f, const dataset * data )
+
+    brief           Writes a record to a run : time key, value, record number,
+                    record type, number of timestamp digits and the strings
+                    led by their lengths.
+
+    param[in]       FILE * f, the run
+    param[in]       const dataset * data, the record
+
+    return          int, error code
+*/
+static int _write_run_record( FILE * f, const dataset * data )
+    {
+    char buffer[RUN_RECORD_LEN];
+    char * p = buffer;
+    const char * strings[3] = { data->UTID, data->unit, data->flags };
+    size_t len;
+    int i;
+
+    memcpy(p, &data->time_key, sizeof(data->time_key));
+    p += sizeof(data->time_key);
+    memcpy(p, &data->result, sizeof(data->result));
+    p += sizeof(data->result);
+    memcpy(p, &data->record_number, sizeof(data->record_number));
+    p += sizeof(data->record_number);
+    *p++ = data->record_type;
+    *p++ = (char)strnlen(data->timestamp, sizeof(data->timestamp) - 1);
+    for( i = 0; i < 3; ++i )
+        {
+        len = strlen(strings[i]);
+        *p++ = (char)len;
+        memcpy(p, strings[i], len);
+        p += len;
+        }
+
+    len = (size_t)(p - buffer);
+    if( fwrite(buffer, 1, len, f) != len )
+        return ERR_WRITE_TO_FILE;
+
+    return NOERR;
+    }
+
+
+/*  function        static int _read_run_record( FILE * f, dataset * data, int * found )
+
+    brief           Reads a record written by _write_run_record().
+
+    param[in]       FILE * f, the run
+    param[out]      dataset * data, the record
+    param[out]      int * found, FALSE at the end of the run
+
+    return          int, error code
+*/
+static int _read_run_record( FILE * f, dataset * data, int * found )
+    {
+    char buffer[RUN_RECORD_HEAD];
+    char * p = buffer;
+    char * strings[3] = { data->UTID, data->unit, data->flags };
+    size_t sizes[3] = { sizeof(data->UTID), sizeof(data->unit), sizeof(data->flags) };
+    int len;
+    int i;
+
+    *found = FALSE;
+    if( fread(buffer, 1, RUN_RECORD_HEAD, f) != RUN_RECORD_HEAD )
+        return ferror(f) ? EIO : NOERR;
+
+    memset(data, 0, sizeof(dataset));
+    memcpy(&data->time_key, p, sizeof(data->time_key));
+    p += sizeof(data->time_key);
+    memcpy(&data->result, p, sizeof(data->result));
+    p += sizeof(data->result);
+    memcpy(&data->record_number, p, sizeof(data->record_number));
+    p += sizeof(data->record_number);
+    data->record_type = *p++;
+    key_timestamp(data->timestamp, data->time_key, *p);
+    for( i = 0; i < 3; ++i )
+        {
+        len = fgetc(f);
+        if( ( len == EOF ) || ( (size_t)len >= sizes[i] ) || ( fread(strings[i], 1, (size_t)len, f) != (size_t)len ) )
+            return EIO;                                                         // runs are written by us, they can't be wrong
+        }
+    *found = TRUE;
+
+    return NOERR;
+    }
+
+
+/*  function        static int _earlier( const source * sources, int a, int b )
+
+    brief           Compares the current records of two inputs. Records of
+                    the same time are taken in the order of the inputs.
+
+    param[in]       const source * sources, the inputs
+    param[in]       int a, index of the first input
+    param[in]       int b, index of the second input
+
+    return          int, TRUE if input a's record comes first
+*/
+static int _earlier( const source * sources, int a, int b )
+    {
+    if( sources[a].data.time_key != sources[b].data.time_key )
+        return sources[a].data.time_key < sources[b].data.time_key;
+
+    return a < b;
+    }
+
+
+/*  function        static void _sift_down( const source * sources, int * heap, int size, int i )
+
+    brief           Moves heap element <i> down until both of its children
+                    are later than it.
+
+    param[in]       const source * sources, the inputs
+    param[in/out]   int * heap, indices of the inputs, the earliest first
+    param[in]       int size, number of heap elements
+    param[in]       int i, the element to move
+*/
+static void _sift_down( const source * sources, int * heap, int size, int i )
+    {
+    int child;
+    int top = heap[i];
+
+    while( ( child = 2 * i + 1 ) < size )
+        {
+        if( ( child + 1 < size ) && _earlier(sources, heap[child + 1], heap[child]) )
+            ++child;
+        if( !_earlier(sources, heap[child], top) )
+            break;
+        heap[i] = heap[child];
+        i = child;
+        }
+    heap[i] = top;
+    }
+
+
+/*  function        static int _spill_run( dataset * data, size_t records, source * s )
+
+    brief           Sorts a run of records and writes it to a temporary file
+                    that becomes an input of the merge.
+
+    param[in]       dataset * data, the records
+    param[in]       size_t records, number of records
+    param[out]      source * s, the input
+
+    return          int, error code
+*/
+static int _spill_run( dataset * data, size_t records, source * s )
+    {
+    int result;
+    size_t i;
+
+    result = _sort_records(data, records);
+    if( result )
+        return result;
+
+    s->run = tmpfile();                                                         // removed when closed
+    if( s->run == 0 )
+        return errno;
+    for( i = 0; ( i < records ) && ( result == NOERR ); ++i )
+        result = _write_run_record(s->run, data + i);
+    if( ( result == NOERR ) && ( fflush(s->run) != 0 ) )
+        result = ERR_WRITE_TO_FILE;
+    rewind(s->run);
+    debug("Run of %lu records spilled\n", records);
+
+    return result;
+    }
+
+
+/*  function        static int _merge_run_files( source * runs, int n, source * out )
+
+    brief           Merges sorted runs into a new run and closes them.
+                    Records of the same time keep the order of the runs.
+
+    param[in/out]   source * runs, the runs
+    param[in]       int n, number of runs
+    param[out]      source * out, the merged run
+
+    return          int, error code
+*/
+static int _merge_run_files( source * runs, int n, source * out )
+    {
+    int result = NOERR;
+    int heap[MAX_RUNS];
+    int size = 0;
+    int found;
+    int i;
+
+    out->run = tmpfile();                                                       // removed when closed
+    if( out->run == 0 )
+        result = errno;
+    for( i = 0; ( i < n ) && ( result == NOERR ); ++i )
+        {
+        result = _read_run_record(runs[i].run, &runs[i].data, &found);
+        if( found )
+            heap[size++] = i;
+        }
+    for( i = size / 2 - 1; i >= 0; --i )
+        _sift_down(runs, heap, size, i);
+
+    while( ( size > 0 ) && ( result == NOERR ) )
+        {
+        result = _write_run_record(out->run, &runs[heap[0]].data);
+        if( result == NOERR )
+            result = _read_run_record(runs[heap[0]].run, &runs[heap[0]].data, &found);
+        if( ( result == NOERR ) && !found )
+            heap[0] = heap[--size];
+        _sift_down(runs, heap, size, 0);
+        }
+    if( ( result == NOERR ) && ( fflush(out->run) != 0 ) )
+        result = ERR_WRITE_TO_FILE;
+    if( out->run )
+        rewind(out->run);
+
+    for( i = 0; i < n; ++i )
+        {
+        fclose(runs[i].run);
+        runs[i].run = 0;
+        }
+
+    return result;
+    }
+
+
+/*  function        static int _cascade_runs( source * sources, int * count, int first )
+
+    brief           Keeps the number of runs of a file, each an open
+                    temporary file, small : whenever the last MAX_RUNS runs
+                    are of the same level they are merged into one run of
+                    the next level. So a file needs at most MAX_RUNS runs
+                    per level, and every record is merged once per level.
+
+    param[in/out]   source * sources, the inputs
+    param[in/out]   int * count, number of inputs
+    param[in]       int first, the file's first run
+
+    return          int, error code
+*/
+static int _cascade_runs( source * sources, int * count, int first )
+    {
+    int result = NOERR;
+    int top;
+    source merged;
+
+    while( ( result == NOERR ) && ( *count - first >= MAX_RUNS ) )
+        {
+        top = *count - MAX_RUNS;
+        if( sources[top].level != sources[*count - 1].level )                   // levels only go down from the first run
+            break;
+        memset(&merged, 0, sizeof(source));
+        merged.level = sources[top].level + 1;
+        merged.file = sources[top].file;
+        result = _merge_run_files(sources + top, MAX_RUNS, &merged);
+        sources[top] = merged;
+        *count = top + 1;
+        debug("%d runs merged into a run of level %d\n", MAX_RUNS, merged.level);
+        }
+
+    return result;
+    }
+
+
+/*  function        static int _spill_held( source * sources, int count, size_t * held )
+
+    brief           Writes the records of the inputs kept in memory to runs,
+                    giving their memory back to the sort budget.
+
+    param[in/out]   source * sources, the inputs
+    param[in]       int count, number of inputs
+    param[in/out]   size_t * held, records kept in memory by all inputs
+
+    return          int, error code
+*/
+static int _spill_held( source * sources, int count, size_t * held )
+    {
+    int result = NOERR;
+    source * s;
+    int i;
+
+    for( i = 0; ( i < count ) && ( result == NOERR ); ++i )
+        {
+        s = sources + i;
+        if( ( s->records == 0 ) || s->f || s->run || s->g.map )
+            continue;
+        result = _spill_run(s->records, s->count, s);                           // sorted already, only written
+        free(s->records);
+        s->records = 0;
+        s->count = 0;
+        }
+    if( result == NOERR )
+        *held = 0;
+
+    return result;
+    }
+
+
+/*  function        static int _sort_in_runs( const char *infile_name, size_t run_records, size_t * held,
+                                              source ** sources, int * count, int * capacity )
+
+    brief           Sorts a file that doesn't fit into memory : runs of
+                    records are sorted and spilled to temporary files, each
+                    run becomes an input of the merge. Runs are merged in
+                    levels, see _cascade_runs(). A file that fits into what
+                    is left of the sort budget is kept in memory, its buffer
+                    cut to the records read. The budget of <run_records> is
+                    shared by all inputs : if more than half of it is held
+                    by files kept in memory they are spilled first.
+
+    param[in]       const char *infile_name, name of the file to read from
+    param[in]       size_t run_records, number of records of the sort budget
+    param[in/out]   size_t * held, records kept in memory by all inputs
+    param[in/out]   source ** sources, the inputs
+    param[in/out]   int * count, number of inputs
+    param[in/out]   int * capacity, number of inputs space is allocated for
+
+    return          int, error code
+*/
+static int _sort_in_runs( const char *infile_name, size_t run_records, size_t * held,
+                          source ** sources, int * count, int * capacity )
+    {
+    int result = NOERR;
+    FILE * infile;
+    char * line = 0;
+    size_t line_len = 0;
+    ssize_t n;
+    dataset * data;
+    size_t records = 0;
+    int runs = 0;
+    int first = *count;
+    line_parser parse = 0;
+    const record_filter * filter = _filter();
+    source * s;
+    dataset * p;
+
+    if( *held > run_records / 2 )
+        {
+        result = _spill_held(*sources, *count, held);
+        if( result )
+            return result;
+        }
+    run_records -= *held;                                                       // what is left of the budget
+    data = (dataset *)malloc(run_records * sizeof(dataset));
+    if( data == 0 )
+        return ERR_NOT_ENOUGH_MEMORY;
+    infile = cfopen(infile_name, "r");
+    if( infile == 0 )
+        {
+        free(data);
+        return errno;
+        }
+    result = _detect_stream_layout(infile, &parse);
+
+    while( ( result == NOERR ) && ( ( n = getline(&line, &line_len, infile) ) != -1 ) )
+        {
+        if( records == run_records )
+            {
+            s = _add_source(sources, count, capacity);
+            result = s ? _spill_run(data, records, s) : ERR_NOT_ENOUGH_MEMORY;
+            if( result == NOERR )
+                result = _cascade_runs(*sources, count, first);
+            records = 0;
+            ++runs;
+            }
+        if( result == NOERR )
+            result = parse(data + records, line, (size_t)n, filter);
+        if( result == ERR_FILTERED )
+            result = NOERR;
+        else if( result == NOERR )
+            ++records;
+        }
+    free(line);
+    fclose(infile);
+
+    if( result == NOERR )
+        {
+        s = _add_source(sources, count, capacity);
+        if( s == 0 )
+            result = ERR_NOT_ENOUGH_MEMORY;
+        else if( runs )
+            {
+            result = _spill_run(data, records, s);
+            if( result == NOERR )
+                result = _cascade_runs(*sources, count, first);
+            }
+        else
+            {
+            p = (dataset *)realloc(data, ( records ? records : 1 ) * sizeof(dataset));
+            if( p )                                                             // fits into memory, give back the rest
+                data = p;
+            s->records = data;
+            s->count = records;
+            *held += records;
+            return _sort_records(data, records);
+            }
+        }
+    free(data);
+
+    return result;
+    }
+
+
+/*  function        static int _open_input( const char *infile_name, size_t check_lines, int unsorted,
+                                            size_t * held, source ** sources, int * count, int * capacity )
+
+    brief           Opens an input file of a merge. A sorted file is read
+                    record by record while merging, an unsorted one is
+                    sorted in memory first or, if a sort budget is set,
+                    sorted in runs. With a time range an uncompressed sorted
+                    file is read from the first day of the range on, found
+                    by its time index, a .gtx file from the first block.
+                    Only the first <check_lines> lines are checked for order,
+                    a sorted file is checked further while it is read.
+
+    param[in]       const char *infile_name, name of the file to read from
+    param[in]       size_t check_lines, lines to check for order, 0 : all
+    param[in]       int unsorted, TRUE if the file is known not to be sorted
+    param[in/out]   size_t * held, records kept in memory within the sort budget
+    param[in/out]   source ** sources, the inputs
+    param[in/out]   int * count, number of inputs
+    param[in/out]   int * capacity, number of inputs space is allocated for
+
+    return          int, error code
+*/
+static int _open_input( const char *infile_name, size_t check_lines, int unsorted,
+                        size_t * held, source ** sources, int * count, int * capacity )
+    {
+    int result;
+    int sorted;
+    size_t run_records;
+    source * s;
+    time_index idx;
+
+    if( gtx_is_file(infile_name) )                                              // sorted by time always
+        {
+        s = _add_source(sources, count, capacity);
+        if( s == 0 )
+            return ERR_NOT_ENOUGH_MEMORY;
+        result = gtx_open(&s->g, infile_name);
+        if( ( result == NOERR ) && get_range_from() )                          // start at the first block of the range
+            {
+            gtx_find(&s->g, get_range_from(), &s->count, &s->next);
+            if( s->count < s->g.header->blocks )
+                gtx_get_block(&s->g, s->count++, &s->block);
+            }
+        return result;
+        }
+
+    if( is_range() && ( cfile_kind_of_file(infile_name) == CFILE_PLAIN ) )
+        {
+        result = _index_file(infile_name, &idx);
+        if( ( result == NOERR ) && idx.sorted )                                 // start at the first day of the range
+            {
+            s = _add_source(sources, count, capacity);
+            if( s == 0 )
+                result = ERR_NOT_ENOUGH_MEMORY;
+            else if( ( s->f = fopen(infile_name, "r") ) == 0 )
+                result = errno;
+            else if( ( result = _detect_stream_layout(s->f, &s->parse) ) != NOERR )
+                ;
+            else if( fseeko(s->f, (off_t)time_index_find(&idx, get_range_from()), SEEK_SET) != 0 )
+                result = errno;
+            time_index_free(&idx);
+            return result;
+            }
+        time_index_free(&idx);
+        if( result )
+            return result;
+        unsorted = TRUE;                                                        // the index checked the whole file
+        }
+
+    sorted = FALSE;
+    result = unsorted ? NOERR : _is_sorted(infile_name, check_lines, &sorted);
+    if( result )
+        return result;
+
+    if( !sorted && get_sort_budget() )
+        {
+        run_records = (size_t)get_sort_budget() * 1024 * 1024 / (2 * sizeof(dataset) + 2 * sizeof(sort_key));
+        debug("%s is not sorted by time, runs of %lu records\n", infile_name, run_records);
+        return _sort_in_runs(infile_name, ( run_records > MIN_RECORDS ) ? run_records : MIN_RECORDS, held,
+                             sources, count, capacity);
+        }
+
+    s = _add_source(sources, count, capacity);
+    if( s == 0 )
+        return ERR_NOT_ENOUGH_MEMORY;
+    s->f = cfopen(infile_name, "r");
+    if( s->f == 0 )
+        return errno;
+    if( sorted )
+        {
+        s->check = ( check_lines != 0 );
+        return _detect_stream_layout(s->f, &s->parse);
+        }
+
+    debug("%s is not sorted by time\n", infile_name);
+    result = _getfile(s->f, &s->records, &s->count);
+    fclose(s->f);
+    s->f = 0;
+
+    return result;
+    }
+
+
+/*  function        static void _close_source( source * s )
+
+    brief           Closes an input of a merge.
+
+    param[in/out]   source * s, the input
+*/
+static void _close_source( source * s )
+    {
+    if( s->f )
+        fclose(s->f);
+    if( s->run )
+        fclose(s->run);
+    if( s->g.map )
+        gtx_close(&s->g);
+    free(s->line);
+    free(s->records);
+    memset(s, 0, sizeof(source));
+    }
+
+
+/*  function        static int _next_record( source * s, int * found )
+
+    brief           Reads the next record of an input into s->data. A
+                    record filtered out gives ERR_FILTERED, only its time
+                    key is sure to be set. A record of a file whose order
+                    was checked in part only that is earlier than the
+                    record before gives ERR_NOT_SORTED.
+
+    param[in/out]   source * s, the input
+    param[out]      int * found, FALSE if there are no more records
+
+    return          int, error code
+*/
+static int _next_record( source * s, int * found )
+    {
+    ssize_t n;
+    int result;
+
+    *found = FALSE;
+    if( s->run )
+        return _read_run_record(s->run, &s->data, found);
+    if( s->g.map )
+        {
+        while( ( s->next == s->block.count ) && ( s->count < s->g.header->blocks ) )
+            {
+            gtx_get_block(&s->g, s->count++, &s->block);                       // count is the next block here
+            s->next = 0;
+            }
+        if( s->next < s->block.count )
+            {
+            gtx_get(&s->g, &s->block, s->next++, &s->data);
+            *found = TRUE;
+            if( is_filter() && !filter_record(get_filter(), &s->data) )
+                return ERR_FILTERED;
+            }
+        return NOERR;
+        }
+    if( s->f == 0 )
+        {
+        if( s->next < s->count )
+            {
+            s->data = s->records[s->next++];
+            *found = TRUE;
+            }
+        return NOERR;
+        }
+
+    n = getline(&s->line, &s->line_len, s->f);                                  // getline allocates memory for "line"
+    if( n == -1 )
+        return NOERR;
+    *found = TRUE;
+
+    result = s->parse(&s->data, s->line, (size_t)n, _filter());
+    if( s->check && ( ( result == NOERR ) || ( result == ERR_FILTERED ) ) )
+        {
+        if( s->data.time_key < s->last_key )
+            return ERR_NOT_SORTED;
+        s->last_key = s->data.time_key;
+        }
+
+    return result;
+    }
 
-    param[in]       FILE * f, data file's handle
 
-    return          long, number of lines
+/*  function        static int _next_in_range( source * s, int * found )
+
+    brief           Reads the next record of an input passing the filter
+                    into s->data. As every input is sorted by time, it ends
+                    with the first record behind the time range, even if the
+                    record was filtered out. An input whose order was
+                    checked in part only is read to its end first, so a
+                    record of the range behind that one still gives
+                    ERR_NOT_SORTED.
+
+    param[in/out]   source * s, the input
+    param[out]      int * found, FALSE if there are no more records
+
+    return          int, error code
 */
-static long _get_num_of_records( FILE * f )
+static int _next_in_range( source * s, int * found )
     {
-    long l;
-    int c;
+    int result;
 
-    l = 0;
-    c = 0xffff;
-    while( c != EOF )
+    do
+        result = _next_record(s, found);
+    while( *found && ( ( result == ERR_FILTERED ) || ( ( result == NOERR ) && ( s->data.time_key < get_range_from() ) ) )
+        && ( s->data.time_key <= get_range_until() ) );
+    if( *found && ( s->data.time_key > get_range_until() ) )
         {
-        c = fgetc(f);
-        if( c == '\n' )
-            ++l;
+        result = NOERR;
+        while( s->check && *found && ( ( result == NOERR ) || ( result == ERR_FILTERED ) ) )
+            result = _next_record(s, found);
+        if( result == ERR_FILTERED )
+            result = NOERR;
+        *found = FALSE;
         }
-    debug("Records found %ld\n", l);
-    fseek(f, 0, SEEK_SET);
 
-    return l;
+    return result;
     }
 
 
-/*  function        static void _shrink( char * line, char c )
+/*  function        static int _merge_pass( const char * const * names, int files, const char *outfile_name,
+                                            formatter format, int dedup, size_t check_lines,
+                                            const char * unsorted, int * failed )
+
+    brief           Merges the records of files into <outfile_name> sorted
+                    by time.
+                    All inputs are read at once record by record, the
+                    earliest record is taken from a heap of the inputs, so
+                    the memory used depends on the number of inputs and not
+                    on their size. Records of the same time keep the order
+                    of the files and of the lines in a file.
+                    Only the records of the time range are put out.
+                    If no <outfile_name> is given the lines go to stdout.
 
-    brief           shrinks multiple occurrences of "c" to one and removes the
-                    trailing newlines
+    param[in]       const char * const * names, names of the files to read from
+    param[in]       int files, number of files
+    param[in]       const char *outfile_name, name of the file to write to
+    param[in]       formatter format, formats one line
+    param[in]       int dedup, TRUE to remove records whose contents were written
+    param[in]       size_t check_lines, lines of a file checked for order, 0 : all
+    param[in]       const char * unsorted, per file : TRUE if known not to be sorted
+    param[out]      int * failed, the file found not sorted if ERR_NOT_SORTED
 
-    param[in/out]   char * line, the line to shrink
-    param[in]       char c, the character to shrink from multiple to one
+    return          int, error code
 */
-static void _shrink( char * line, char c )
+static int _merge_pass( const char * const * names, int files, const char *outfile_name, formatter format, int dedup,
+                        size_t check_lines, const char * unsorted, int * failed )
     {
-    int no_char = 0;
-    char * p_line = line;
-    char dst[LINE_LEN];
-    char * p_dst;
+    int result = NOERR;
+    source * sources = 0;
+    int count = 0;
+    int capacity = 0;
+    int * heap = 0;
+    int size = 0;
+    size_t held = 0;                                                            // records of the sort budget in memory
+    writer out;
+    record_set written;                                                         // records written of the current time
+    long long last_time = 0;
+    int added = TRUE;
+    int found;
+    int first;
+    int i;
 
-    memset(dst, 0, LINE_LEN);
-    p_dst = dst;
-    while( *p_line != 0 )
+    result = record_set_init(&written, 0);
+    if( result )
+        return result;
+    result = _writer_open(&out, outfile_name, format);
+    if( result )
         {
-        if( *p_line != c )
-            {
-            if( *p_line != 0x0a )                                               // remove liefeeds
-                {
-                *(p_dst++) = *p_line;
-                no_char = 0;
-                }
-            }
-        else
+        debug("%s: \n", outfile_name);
+        record_set_free(&written);
+        return result;
+        }
+
+    for( i = 0; ( i < files ) && ( result == NOERR ); ++i )
+        {
+        first = count;
+        result = _open_input(names[i], check_lines, unsorted[i], &held, &sources, &count, &capacity);
+        if( result )
+            debug("%s: \n", names[i]);
+        for( ; first < count; ++first )
+            sources[first].file = i;
+        }
+    if( result == NOERR )
+        {
+        heap = (int *)malloc((size_t)( count ? count : 1 ) * sizeof(int));
+        if( heap == 0 )
+            result = ERR_NOT_ENOUGH_MEMORY;
+        }
+    for( i = 0; ( i < count ) && ( result == NOERR ); ++i )
+        {
+        result = _next_in_range(sources + i, &found);
+        if( result == ERR_NOT_SORTED )
+            *failed = sources[i].file;
+        if( ( result == NOERR ) && found )
+            heap[size++] = i;
+        }
+    for( i = size / 2 - 1; i >= 0; --i )
+        _sift_down(sources, heap, size, i);
+
+    while( ( size > 0 ) && ( result == NOERR ) )
+        {
+        source * s = sources + heap[0];
+
+        if( dedup )
             {
-            if( !no_char )
-                {
-                *(p_dst++) = *p_line;
-                no_char = 1;
-                }
+            if( s->data.time_key != last_time )                                 // no record of a new time is written yet
+                record_set_clear(&written);
+            last_time = s->data.time_key;
+            result = record_set_add(&written, &s->data, &added);
             }
-        ++p_line;
+        if( ( result == NOERR ) && added )
+            result = _writer_put(&out, &s->data);
+
+        if( result == NOERR )
+            result = _next_in_range(s, &found);
+        if( result == ERR_NOT_SORTED )
+            *failed = s->file;
+        if( ( result == NOERR ) && !found )
+            heap[0] = heap[--size];
+        _sift_down(sources, heap, size, 0);
         }
+    result = _writer_close(&out, result);
 
-    strcpy(line, dst);
+    for( i = 0; i < count; ++i )
+        _close_source(sources + i);
+    free(sources);
+    free(heap);
+    record_set_free(&written);
+    return result;
     }
 
 
-/*  function        static int _read_line( dataset * data, char * line )
+/*  function        static int _merge( const char * const * names, int files, const char *outfile_name, formatter format, int dedup )
 
-    brief           Reads a line of CSV formatted data and stores the data to an
-                    instance of type dataset.
+    brief           Merges the records of files into <outfile_name> sorted
+                    by time, see _merge_pass(). The order of a file is
+                    checked on its first lines only, the rest while it is
+                    merged. If a file turns out not to be sorted the merge is
+                    done again with that file sorted first. Lines put out to
+                    stdout can't be taken back, so then every file is checked
+                    in full before.
 
-    param[out]      dataset * data, store the data read in here
-    param[in]       char * line, string containing one line of CVS formatted data
+    param[in]       const char * const * names, names of the files to read from
+    param[in]       int files, number of files
+    param[in]       const char *outfile_name, name of the file to write to
+    param[in]       formatter format, formats one line
+    param[in]       int dedup, TRUE to remove records whose contents were written
 
     return          int, error code
 */
-static int _read_line( dataset * data, char * line )
+static int _merge( const char * const * names, int files, const char *outfile_name, formatter format, int dedup )
     {
-    int error = NOERR;
-    char elements[ELEMENT_LEN * NUM_OF_ELEMENTS] = {0, };
-    unsigned int num_of_elements;
-    char result_buffer[ELEMENT_LEN];
-    char const str_mg[] = "mg";
-    char const str_mml[] = "mm";
-    int i;
-    char * unit;
-
-    _shrink(line, ' ');
-    debug("Shrunk \"%s\"\n", line);
-    memset(data, 0, sizeof(dataset));
+    int result;
+    char * unsorted;
+    int failed = 0;
 
-    memset(result_buffer, 0, ELEMENT_LEN);
-    num_of_elements = explode(elements, line, ' ', NUM_OF_ELEMENTS, ELEMENT_LEN);
+    unsorted = (char *)calloc((size_t)( files ? files : 1 ), sizeof(char));
+    if( unsorted == 0 )
+        return ERR_NOT_ENOUGH_MEMORY;
 
-    if( *elements == 'R' )
+    do
         {
-        debug("Number of elements in old record : %d\n", num_of_elements);
-        if( num_of_elements == 6 )
+        result = _merge_pass(names, files, outfile_name, format, dedup,
+                             *outfile_name ? SORT_CHECK_LINES : 0, unsorted, &failed);
+        if( result == ERR_NOT_SORTED )
             {
-            data->record_type = elements[0];
-            sscanf(elements + ELEMENT_LEN, "%d", &(data->record_number));
-            strncpy(data->UTID, elements + 2 * ELEMENT_LEN, sizeof(data->UTID));
-            strncpy(data->timestamp, elements + 3 * ELEMENT_LEN, sizeof(data->timestamp));
-            sscanf(elements + 4 * ELEMENT_LEN, "%d", &(data->result));
-            unit = strstr(elements + 4 * ELEMENT_LEN, str_mg);
-            if( unit == 0 )
-                unit = strstr(elements + 4 * ELEMENT_LEN, str_mml);
-            strncpy(data->unit, unit, sizeof(data->unit));
-            strncpy(data->flags, elements + 5 * ELEMENT_LEN, 1);
+            debug("%s is not sorted by time, merged again\n", names[failed]);
+            unsorted[failed] = TRUE;
             }
-        else
-            error = ERR_NUM_OF_DATA_IN_LINE;
         }
-    else
+    while( result == ERR_NOT_SORTED );
+
+    free(unsorted);
+    return result;
+    }
+
+
+/*  function        static int _merge_runs( const run * a, const run * b, run * out )
+
+    brief           Merges two sorted runs into a new one, removing records
+                    whose contents are in the new run already. Records of the
+                    same time are taken from <a> first.
+
+    param[in]       const run * a, first run
+    param[in]       const run * b, second run, may be empty
+    param[out]      run * out, the merged run
+
+    return          int, error code
+*/
+static int _merge_runs( const run * a, const run * b, run * out )
+    {
+    record_set written;                                                         // records of the current time
+    long long last_time = 0;
+    const dataset * next;
+    size_t i = 0;
+    size_t j = 0;
+    int added;
+    int result;
+
+    out->count = 0;
+    out->data = (dataset *)malloc(( a->count + b->count + 1 ) * sizeof(dataset));
+    if( out->data == 0 )
+        return ERR_NOT_ENOUGH_MEMORY;
+    result = record_set_init(&written, 0);
+
+    while( ( result == NOERR ) && ( ( i < a->count ) || ( j < b->count ) ) )
         {
-        memset(result_buffer, 0, ELEMENT_LEN);
-        num_of_elements = explode(elements, line, ' ', NUM_OF_ELEMENTS, ELEMENT_LEN);
-        debug("Number of elements in new record : %d\n", num_of_elements);
-        if( ( num_of_elements == 6 ) || ( num_of_elements == 7 ) )
-            {
-            memcpy(data->timestamp, elements, sizeof(data->timestamp) - 1);
-            sscanf(elements + ELEMENT_LEN, "%s", result_buffer);
-            strncpy(data->unit, elements + 2 * ELEMENT_LEN, sizeof(data->unit));
-            i = 3;
-            if( num_of_elements == 7 )
-                {
-                strncpy(data->flags, elements + i * ELEMENT_LEN, sizeof(data->flags));
-                ++i;
-                }
-            strncpy(data->UTID, elements + i * ELEMENT_LEN, sizeof(data->UTID));
-            ++i;
-            data->record_type = elements[i * ELEMENT_LEN];
-            ++i;
-            sscanf(elements + i * ELEMENT_LEN, "%d", &(data->record_number));
-            if( ( data->UTID[0] == 'I' ) || ( data->UTID[0] == 'W' ) )
-                {
-                int i1, i2, num;
-                num = sscanf(result_buffer, "%d.%d", &i1, &i2);
-                if( num == 2 )
-                    data->result = i1 * 10 + i2;
-                else
-                    data->result = i1;
-                }
-            else
-                sscanf(result_buffer, "%d", &(data->result));
-            }
+        if( ( j == b->count ) || ( ( i < a->count ) && ( a->data[i].time_key <= b->data[j].time_key ) ) )
+            next = a->data + i++;
         else
-            error = ERR_NUM_OF_DATA_IN_LINE;
+            next = b->data + j++;
+        if( next->time_key != last_time )                                       // no record of a new time is taken yet
+            record_set_clear(&written);
+        last_time = next->time_key;
+        result = record_set_add(&written, next, &added);
+        if( added )
+            out->data[out->count++] = *next;
         }
 
-    return error;
+    record_set_free(&written);
+    return result;
     }
 
 
-/*  function        static void _compare_timestamp( void const * data1, void const * data2 )
+/*  function        static void _load_job( void * arg, int job )
 
-    brief           Compares to timestamps.
-                    Returns an integer less than, equal to, or greater than zero
-                    corresponding to whether the first timestamp is less than,
-                    equal to, or greater than the second timestamp.
+    brief           Reads, sorts and dedups one file into a run, a job of
+                    the pool.
 
-    param[in]       void const * data1, record to get the first timestamp from
-    param[in]       void const * data2, record to get the second timestamp from
-
-    return          int, result of comparison (s.o.)
+    param[in/out]   void * arg, the ingest
+    param[in]       int job, number of the file
 */
-static int _compare_timestamp( void const * data1, void const * data2 )
+static void _load_job( void * arg, int job )
     {
-    char * timestamp1 = ((dataset *)data1)->timestamp;
-    char * timestamp2 = ((dataset *)data2)->timestamp;
+    ingest * in = (ingest *)arg;
+    run loaded = { 0, 0 };
+    run empty = { 0, 0 };
+
+    in->runs[job].data = 0;
+    in->runs[job].count = 0;
+    in->results[job] = _load(in->names[job], &loaded.data, &loaded.count);
+    if( in->results[job] )
+        debug("%s: \n", in->names[job]);
+    else
+        in->results[job] = _merge_runs(&loaded, &empty, in->runs + job);
+    free(loaded.data);
+    }
+
 
-    return strcmp(timestamp1, timestamp2);
+/*  function        static void _merge_job( void * arg, int job )
+
+    brief           Merges two neighbouring runs of a level of the merge
+                    tree into one run of the next level, a job of the pool.
+
+    param[in/out]   void * arg, the ingest
+    param[in]       int job, number of the run of the next level
+*/
+static void _merge_job( void * arg, int job )
+    {
+    ingest * in = (ingest *)arg;
+    run * a = in->runs + 2 * job;
+    run * b = a + 1;
+    run merged = { 0, 0 };
+
+    in->results[job] = _merge_runs(a, b, &merged);
+    free(a->data);
+    free(b->data);
+    a->data = 0;
+    b->data = 0;
+    in->merged[job] = merged;
     }
 
 
-/*  function        static int _getfile( FILE * f, dataset * p_data, size_t * records )
+/*  function        static int _gather( const char * const * names, int files, run * all )
 
-    brief           Get a file, allocate enough memory and read the data
-                    into an array of type dataset.
-                    On error p_data and/or the array contents are undefined.
-                    --- You have to free the memory elsewhere ---
+    brief           Reads many files at once : the threads of the pool read
+                    and sort every file into a run, then merge neighbouring
+                    runs level by level until one run is left. Duplicate
+                    records are removed on every level.
+                    --- You have to free all->data elsewhere ---
 
-    param[in]       FILE * f, file handle
-    param[out]      dataset ** p_data, pointer to dataset array
-    param[out]      size_t * records, number of records in the dataset array
+    param[in]       const char * const * names, names of the files to read from
+    param[in]       int files, number of files
+    param[out]      run * all, the records of all files sorted by time
 
     return          int, error code
 */
-static int _getfile( FILE * f, dataset ** p_data, size_t * records )
+static int _gather( const char * const * names, int files, run * all )
     {
-    int error = NOERR;
-    int i = 0;
-    char * line = 0;
-    size_t len = 0;
-    ssize_t n;
-    dataset * data;
-    assert(f);
-
-    *records = (size_t)_get_num_of_records(f);
-    data = (dataset *)malloc(*records * sizeof(dataset));
-    if( data == 0 )
-        return ERR_NOT_ENOUGH_MEMORY;
-    *p_data = data;
+    int result = NOERR;
+    ingest in;
+    run * swap;
+    int runs = files;
+    int pairs;
+    int i;
 
-    while( (n = getline(&line, &len, f)) != -1 )    // getline allocates memory for "line"
+    all->data = 0;
+    all->count = 0;
+    in.names = names;
+    in.runs = (run *)calloc((size_t)files, sizeof(run));
+    in.merged = (run *)calloc((size_t)files, sizeof(run));
+    in.results = (int *)calloc((size_t)files, sizeof(int));
+    if( ( in.runs == 0 ) || ( in.merged == 0 ) || ( in.results == 0 ) )
         {
-        error = _read_line(data + i, line);
-        if( error )
-            goto _getfile_err;
-        ++i;
+        result = ERR_NOT_ENOUGH_MEMORY;
+        goto gather_err;
         }
 
-    qsort(data, *records, sizeof(dataset), _compare_timestamp);
+    pool_run(files, _load_job, &in);
+    for( i = 0; ( i < files ) && ( result == NOERR ); ++i )
+        result = in.results[i];
 
-_getfile_err:
-    free(line);
+    while( ( runs > 1 ) && ( result == NOERR ) )
+        {
+        pairs = runs / 2;
+        pool_run(pairs, _merge_job, &in);
+        for( i = 0; ( i < pairs ) && ( result == NOERR ); ++i )
+            result = in.results[i];
+        if( runs & 1 )                                                          // the last run goes up a level as it is
+            {
+            in.merged[pairs] = in.runs[runs - 1];
+            in.runs[runs - 1].data = 0;
+            }
+        debug("%d runs merged into %d\n", runs, ( runs + 1 ) / 2);
+        runs = ( runs + 1 ) / 2;
+        swap = in.runs;
+        in.runs = in.merged;
+        in.merged = swap;
+        }
+    if( result == NOERR )
+        {
+        *all = in.runs[0];
+        in.runs[0].data = 0;
+        }
 
-showerr(error);
-    return error;
+gather_err:
+    for( i = 0; ( i < files ) && in.runs && in.merged; ++i )
+        {
+        free(in.runs[i].data);
+        free(in.merged[i].data);
+        }
+    free(in.runs);
+    free(in.merged);
+    free(in.results);
+    return result;
     }
 
 
-/*  function        int mixfiles( const char *infile_name1, const char *infile_name2, const char *outfile_name )
+/*  function        static int _ingest( const char * const * names, int files, const char *outfile_name, formatter format )
 
-    brief           Reads the data from <infile_name> and sorts them into <outfile_name>
-                    removing duplicate lines.
-                    No functionality yet!!!
+    brief           Reads many files at once, see _gather(), and writes the
+                    records to <outfile_name>. The output is the same as
+                    the one of _merge(), all records are held in memory.
 
-    param[in]       const char *infile_name1, name of the file to read from
-    param[in]       const char *infile_name2, name of the file to read from
+    param[in]       const char * const * names, names of the files to read from
+    param[in]       int files, number of files
     param[in]       const char *outfile_name, name of the file to write to
+    param[in]       formatter format, formats one line
 
     return          int, error code
 */
-int mixfiles( const char *infile_name1, const char *infile_name2, const char *outfile_name )
+static int _ingest( const char * const * names, int files, const char *outfile_name, formatter format )
     {
-    int result = NOERR;
-    FILE * infile[2];
-    FILE * outfile;
-    size_t infile_records[2];
-    dataset * indata[2];
-    int idx[2];
+    int result;
+    run all;
+    writer out;
+    size_t i;
 
-    if( ( infile_name1 == 0 ) || ( infile_name2 == 0 ) )
-        {
-        result = ERR_NO_INFILE;
-        showerr(result);
-        return result;
-        }
-    if( outfile_name == 0 )
+    result = _gather(names, files, &all);
+    if( result == NOERR )
         {
-        result = ERR_NO_LOGFILE;
-        showerr(result);
-        return result;
+        result = _writer_open(&out, outfile_name, format);
+        if( result )
+            debug("%s: \n", outfile_name);
+        else
+            {
+            for( i = 0; ( i < all.count ) && ( result == NOERR ); ++i )
+                result = _writer_put(&out, all.data + i);
+            result = _writer_close(&out, result);
+            }
         }
 
-    infile[0] = fopen(infile_name1, "r");
-    if( infile[0] == 0 )
+    free(all.data);
+    return result;
+    }
+
+
+/*  function        static int _fits_in_memory( const char * const * names, int files )
+
+    brief           Estimates the memory needed to merge files in memory :
+                    every record is held twice while a level of the merge
+                    tree is merged. The number of records is taken from a
+                    .gtx file's header, else from the file's size.
+
+    param[in]       const char * const * names, names of the files
+    param[in]       int files, number of files
+
+    return          int, TRUE if the records take at most 1 / INGEST_MEMORY_SHARE
+                    of the physical memory
+*/
+static int _fits_in_memory( const char * const * names, int files )
+    {
+    unsigned long long records = 0;
+    unsigned long long memory;
+    long pages = sysconf(_SC_PHYS_PAGES);
+    long page_size = sysconf(_SC_PAGE_SIZE);
+    struct stat st;
+    gtx g;
+    int i;
+
+    if( ( pages <= 0 ) || ( page_size <= 0 ) )
+        return TRUE;                                                            // unknown, as before
+    memory = (unsigned long long)pages * (unsigned long long)page_size;
+
+    for( i = 0; i < files; ++i )
         {
-        result = errno;
-        debug("%s: \n", infile_name1);
-        showerr(result);
-        return result;
+        if( gtx_is_file(names[i]) && ( gtx_open(&g, names[i]) == NOERR ) )
+            {
+            records += gtx_records(&g);
+            gtx_close(&g);
+            }
+        else if( stat(names[i], &st) == 0 )
+            records += (unsigned long long)st.st_size / AVERAGE_LINE_LEN
+                     * ( ( cfile_kind_of_file(names[i]) == CFILE_PLAIN ) ? 1 : COMPRESSION_RATIO );
         }
-    infile[1] = fopen(infile_name2, "r");
-    if( infile[1] == 0 )
+    debug("About %llu records, %llu MB of memory\n", records, memory >> 20);
+
+    return records * 2 * sizeof(dataset) <= memory / INGEST_MEMORY_SHARE;
+    }
+
+
+/*  function        int mixfiles( const char *outfile_name )
+
+    brief           Mixes the records of all input files into <outfile_name>
+                    sorted by time, removing duplicate records. Records are
+                    the same if time, type, value, unit and flags are, so
+                    downloads that number the records differently mix.
+                    The files are read and merged in memory by the threads
+                    of the pool if their records fit into a part of the
+                    memory. Else, with a sort budget or with a time range
+                    they are streamed and merged at once instead, files that
+                    are not sorted are sorted in runs. With a time range the
+                    records of the range only are read where the files allow.
+                    The format is the data file format, CSV with -c or JSON
+                    lines with -j. If no <outfile_name> is given the lines
+                    go to stdout.
+
+    param[in]       const char *outfile_name, name of the file to write to
+
+    return          int, error code
+*/
+int mixfiles( const char *outfile_name )
+    {
+    int result;
+    int files = get_infile_number();
+    const char ** names;
+    formatter format = is_cvs_out() ? format_csv : ( is_json_out() ? format_json : format_line );
+    int i;
+
+    if( files == 0 )
         {
-        result = errno;
-        debug("%s: \n", infile_name2);
+        result = ERR_NO_INFILE;
         showerr(result);
-        fclose(infile[0]);
         return result;
         }
-    outfile = fopen(outfile_name, "w");
-    if( outfile == 0 )
+
+    names = (const char **)malloc((size_t)files * sizeof(char *));
+    if( names == 0 )
         {
-        result = errno;
-        debug("%s: \n", outfile_name);
+        result = ERR_NOT_ENOUGH_MEMORY;
         showerr(result);
-        fclose(infile[0]);
-        fclose(infile[1]);
         return result;
         }
+    for( i = 0; i < files; ++i )
+        names[i] = get_infile_name(i);
 
-    result = _getfile(infile[0], &(indata[0]), &(infile_records[0]));
-    if( result )
-        goto mixfiles_err;
-    result = _getfile(infile[1], &(indata[1]), &(infile_records[1]));
+    if( get_sort_budget() || is_range() || !_fits_in_memory(names, files) )
+        result = _merge(names, files, outfile_name, format, TRUE);
+    else
+        result = _ingest(names, files, outfile_name, format);
+    showerr(result);
+
+    free(names);
+    return result;
+    }
 
-    fclose(infile[0]);
-    fclose(infile[1]);
 
-    if( result )
-        goto mixfiles_err;
+/*  function        static int _convert( const char *infile_name, const char *outfile_name, formatter format )
+
+    brief           Reads the data from <infile_name>, sorts it by time and
+                    writes it to <outfile_name> in the format given.
+                    The lines are formatted into a block that is written
+                    when it is full.
+                    With a sort budget a file too large for it is sorted in
+                    runs kept in temporary files that are merged.
+
+    param[in]       const char *infile_name, name of the file to read from
+    param[in]       const char *outfile_name, name of the file to write to
+    param[in]       formatter format, formats one line
+
+    result          int, error code
+*/
+static int _convert( const char *infile_name, const char *outfile_name, formatter format )
+    {
+    int result;
+    size_t infile_records;
+    size_t i;
+    dataset * indata;
+    writer out;
+
+    if( get_sort_budget() )
+        return _merge(&infile_name, 1, outfile_name, format, FALSE);
 
-    idx[0] = 0;
-    idx[1] = 0;
-    while( ( idx[0] < infile_records[0] ) || ( idx[1] < infile_records[1] ) )
+    result = _load(infile_name, &indata, &infile_records);
+    if( result == NOERR )
         {
-        int res = memcmp(indata[0] + idx[0], indata[1] + idx[1], sizeof(dataset)-sizeof(int));
-        if( res == 0 )
-            {
-            printline(indata[0] + idx[0], outfile);
-            ++idx[0];
-            ++idx[1];
-            }
-        else if( res < 0 && ( idx[0] < infile_records[0] ) )
+        result = _writer_open(&out, outfile_name, format);
+        if( result == NOERR )
             {
-            printline(indata[0] + idx[0], outfile);
-            ++idx[0];
-            }
-        else if( idx[1] < infile_records[1] )
-            {
-            printline(indata[1] + idx[1], outfile);
-            ++idx[1];
+            for( i = 0; ( i < infile_records ) && ( result == NOERR ); ++i )
+                result = _writer_put(&out, indata + i);
+            result = _writer_close(&out, result);
             }
         }
+    if( result )
+        showerr(result);
 
-mixfiles_err:
-    free(indata[0]);
-    free(indata[1]);
-    fclose(outfile);
+    free(indata);
     return result;
     }
 
@@ -403,111 +2300,193 @@ mixfiles_err:
     result          int, error code
 */
 int csvformat( const char *infile_name, const char *outfile_name )
+    {
+    return _convert(infile_name, outfile_name, format_csv);
+    }
+
+
+/*  function        int reformat( const char *infile_name, const char *outfile_name )
+
+    brief           Reads the data from <infile_name> in any data order, e.g.
+                    the one used before 30.3.2018, and writes it to
+                    <outfile_name> in the current data order.
+
+    param[in]       const char *infile_name, name of the file to read from
+    param[in]       const char *outfile_name, name of the file to write to
+
+    result          int, error code
+*/
+int reformat( const char *infile_name, const char *outfile_name )
+    {
+    return _convert(infile_name, outfile_name, format_line);
+    }
+
+
+/*  function        int jsonformat( const char *infile_name, const char *outfile_name )
+
+    brief           Reads the data from <infile_name> and writes it to
+                    <outfile_name> as JSON lines, one object per record.
+                    The records are streamed in the order of the file, so
+                    the memory used does not depend on the file's size.
+                    If no <outfile_name> is given the lines go to stdout.
+                    A .gtx file is read, and a .gtx <outfile_name> written,
+                    sorted by time like any other conversion.
+
+    param[in]       const char *infile_name, name of the file to read from
+    param[in]       const char *outfile_name, name of the file to write to
+
+    result          int, error code
+*/
+int jsonformat( const char *infile_name, const char *outfile_name )
     {
     int result = NOERR;
     FILE * infile;
-    FILE * outfile;
-    size_t infile_records;
-    int i;
-    char line[256];
-    int chars_written;
-    char * p_line;
-    dataset * indata;
-    dataset * p_indata;
+    writer out;
+    char * line = 0;
+    size_t line_len = 0;
+    ssize_t n;
+    dataset data;
+    line_parser parse = 0;
+    const record_filter * filter = _filter();
 
-    infile = fopen(infile_name, "r");
+    if( gtx_is_file(infile_name) || gtx_is_name(outfile_name) )                // .gtx needs the records sorted
+        return _convert(infile_name, outfile_name, format_json);
+
+    infile = cfopen(infile_name, "r");
     if( infile == 0 )
         {
         result = errno;
         showerr(result);
         return result;
         }
-    outfile = fopen(outfile_name, "w");
-    if( outfile == 0 )
+    result = _writer_open(&out, outfile_name, format_json);
+    if( result )
         {
-        result = errno;
         showerr(result);
         fclose(infile);
         return result;
         }
+    result = _detect_stream_layout(infile, &parse);
 
-    result = _getfile(infile, &indata, &infile_records);
-    if( result )
-        goto csvformat_err;
-    p_indata = indata;
-
-    for( i = 0; i < infile_records; ++i )
-        {
-        p_line = line;
-        memcpy(p_line, p_indata->timestamp+6, 2);
-        p_line += 2;
-        *p_line++ = '.';
-        memcpy(p_line, p_indata->timestamp+4, 2);
-        p_line += 2;
-        *p_line++ = '.';
-        memcpy(p_line, p_indata->timestamp, 4);
-        p_line += 4;
-        *p_line++ = '|';
-        memcpy(p_line, p_indata->timestamp+8, 2);
-        p_line += 2;
-        *p_line++ = ':';
-        memcpy(p_line, p_indata->timestamp+10, 2);
-        p_line += 2;
-        *p_line++ = '|';
-        if( *p_indata->UTID == 'G' )
-            {
-            chars_written = sprintf(p_line, "%d|", (int)(p_indata->result));
-            p_line += chars_written;
-            chars_written = sprintf(p_line, "%s|", p_indata->unit);
-            }
-        else
-            chars_written = sprintf(p_line, "||");
-        p_line += chars_written;
-        if( *p_indata->UTID == 'I' )
-            {
-            chars_written = sprintf(p_line, "%d,%d|",
-                p_indata->result/10, p_indata->result%10);
-            p_line += chars_written;
-            chars_written = sprintf(p_line, "%s|", p_indata->unit);
-            }
-        else
-            chars_written = sprintf(p_line, "||");
-        p_line += chars_written;
-        if( *p_indata->UTID == 'C' )
-            {
-            chars_written = sprintf(p_line, "%d|", (int)(p_indata->result));
-            p_line += chars_written;
-            switch( *p_indata->unit )
-                {
-                case '1':
-                    chars_written = sprintf(p_line, "Gramm|");
-                    break;
-                case '2':
-                    chars_written = sprintf(p_line, "BE|");
-                    break;
-                case '3':
-                    chars_written = sprintf(p_line, "KE|");
-                    break;
-                default:
-                    chars_written = sprintf(p_line, "|");
-                    break;
-                }
-            }
-        else
-            chars_written = sprintf(p_line, "||");
-        p_line += chars_written;
-        chars_written = sprintf(p_line, "%s", p_indata->flags);
-        p_line += chars_written;
-        *p_line++ = 0x0a;
-        *p_line++ = 0;                              // close string
-        debug("%s", line);
-        fprintf(outfile, "%s", line);
-        p_indata++;
-        }
-
-csvformat_err:
-    fclose(outfile);
+    while( ( result == NOERR ) && ( ( n = getline(&line, &line_len, infile) ) != -1 ) )
+        {
+        result = parse(&data, line, (size_t)n, filter);
+        if( result == NOERR )
+            result = _writer_put(&out, &data);
+        else if( result == ERR_FILTERED )
+            result = NOERR;
+        if( result )
+            break;
+        }
+    result = _writer_close(&out, result);
+    showerr(result);
+
+    free(line);
     fclose(infile);
-    free(indata);
+    return result;
+    }
+
+
+/*  function        static int _master_export( const master * m, const char *outfile_name, formatter format )
+
+    brief           Writes all records of the master history, merged from
+                    its segments, to <outfile_name>. With a time range only
+                    the segments overlapping it are read.
+
+    param[in]       const master * m, the master history
+    param[in]       const char *outfile_name, name of the file to write to
+    param[in]       formatter format, formats one line
+
+    return          int, error code
+*/
+static int _master_export( const master * m, const char *outfile_name, formatter format )
+    {
+    int result = NOERR;
+    char (* paths)[MASTER_PATH_LEN];
+    const char ** names;
+    int files = 0;
+    size_t i;
+
+    if( m->count == 0 )
+        return ERR_NO_INFILE;
+
+    paths = (char (*)[MASTER_PATH_LEN])malloc(m->count * MASTER_PATH_LEN);
+    names = (const char **)malloc(m->count * sizeof(char *));
+    if( ( paths == 0 ) || ( names == 0 ) )
+        result = ERR_NOT_ENOUGH_MEMORY;
+    for( i = 0; ( i < m->count ) && ( result == NOERR ); ++i )
+        {
+        if( ( m->segments[i].max_time < get_range_from() ) || ( m->segments[i].min_time > get_range_until() ) )
+            continue;
+        result = master_segment_path(m, i, paths[files], MASTER_PATH_LEN);
+        names[files] = paths[files];
+        ++files;
+        }
+    if( result == NOERR )
+        result = _merge(names, files, outfile_name, format, TRUE);
+
+    free(names);
+    free(paths);
+    return result;
+    }
+
+
+/*  function        int masterfiles( const char *master_name, const char *outfile_name )
+
+    brief           Appends the records of all input files to the master
+                    history in the directory <master_name>. Only records
+                    not in the master yet are appended, checked against the
+                    segments overlapping their time range.
+                    Without input files all records of the master history
+                    are written to <outfile_name> instead.
+
+    param[in]       const char *master_name, the master's directory
+    param[in]       const char *outfile_name, name of the file to write to
+
+    return          int, error code
+*/
+int masterfiles( const char *master_name, const char *outfile_name )
+    {
+    int result;
+    master m;
+    run all = { 0, 0 };
+    const char ** names;
+    int files = get_infile_number();
+    formatter format = is_cvs_out() ? format_csv : ( is_json_out() ? format_json : format_line );
+    size_t added;
+    int i;
+
+    result = master_open(&m, master_name);
+    if( result )
+        {
+        showerr(result);
+        return result;
+        }
+
+    if( files == 0 )
+        {
+        result = _master_export(&m, outfile_name, format);
+        showerr(result);
+        master_close(&m);
+        return result;
+        }
+
+    names = (const char **)malloc((size_t)files * sizeof(char *));
+    if( names == 0 )
+        result = ERR_NOT_ENOUGH_MEMORY;
+    for( i = 0; ( i < files ) && names; ++i )
+        names[i] = get_infile_name(i);
+
+    if( result == NOERR )
+        result = _gather(names, files, &all);
+    if( result == NOERR )
+        result = master_append(&m, all.data, all.count, &added);
+    if( result == NOERR )
+        printf("%lu of %lu records appended to %s\n", added, all.count, master_name);
+    showerr(result);
+
+    free(all.data);
+    free(names);
+    master_close(&m);
     return result;
     }
@@ -0,0 +1,290 @@
+/*
+    Copyright (C)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+    See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.
+    If not, see <http://www.gnu.org/licenses/>.
+
+    Klabautermann Software
+    Uwe Jantzen
+    Weingartener Straße 33
+    76297 Stutensee
+    Germany
+
+    file        filter.c
+
+    date        19.10.2026
+
+    author      Uwe Jantzen (jantzen@klabautermann-software.de)
+
+    brief       Filters of the records read
+
+    details     A filter is checked while a record is read, by the file
+                parsers and the ASTM decoder, in the order of the cost
+                to find the field : time, type, meal markers, value. A
+                record not taken is never made.
+
+    project     glucotux
+    target      Linux
+    begin       03.03.2012
+
+    note
+
+    todo
+
+*/
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <limits.h>
+#include "errors.h"
+#include "globals.h"
+#include "astm.h"
+#include "filter.h"
+
+
+#define MARKERS                             "BAFNO"                             // before/after meal, fasting, none, other
+
+
+/*  function        void filter_init( record_filter * f )
+
+    brief           Makes a filter every record passes.
+
+    param[out]      record_filter * f, the filter
+*/
+void filter_init( record_filter * f )
+    {
+    memset(f, 0, sizeof(record_filter));
+    f->from = 0;
+    f->until = LLONG_MAX;
+    f->min_value = INT_MIN;
+    f->max_value = INT_MAX;
+    }
+
+
+/*  function        int filter_is_set( const record_filter * f )
+
+    brief           Tells if a filter may reject a record.
+
+    param[in]       const record_filter * f, the filter
+
+    return          int, TRUE if any limit is set
+*/
+int filter_is_set( const record_filter * f )
+    {
+    return ( f->from != 0 ) || ( f->until != LLONG_MAX ) || f->types || *f->markers
+        || ( f->min_value != INT_MIN ) || ( f->max_value != INT_MAX );
+    }
+
+
+/*  function        int filter_set_types( record_filter * f, const char * names )
+
+    brief           Sets the types of records taken from a list like
+                    "Glucose,Carb", the case of the names does not matter.
+
+    param[in/out]   record_filter * f, the filter
+    param[in]       const char * names, the types separated by ','
+
+    return          int, error code
+*/
+int filter_set_types( record_filter * f, const char * names )
+    {
+    static const char * const types[] = { "Glucose", "Insulin", "Carb" };      // in the order of the FILTER_... bits
+    const char * p = names;
+    size_t len;
+    size_t i;
+
+    f->types = 0;
+    while( *p )
+        {
+        len = strcspn(p, ",");
+        for( i = 0; i < sizeof(types) / sizeof(types[0]); ++i )
+            {
+            if( ( strlen(types[i]) == len ) && ( strncasecmp(p, types[i], len) == 0 ) )
+                break;
+            }
+        if( i == sizeof(types) / sizeof(types[0]) )
+            return ERR_FILTER_FORMAT;
+        f->types |= 1U << i;
+        p += len;
+        if( *p == ',' )
+            ++p;
+        }
+
+    return NOERR;
+    }
+
+
+/*  function        int filter_set_markers( record_filter * f, const char * markers )
+
+    brief           Sets the meal markers of the records taken, e.g. "BA"
+                    for before and after a meal.
+
+    param[in/out]   record_filter * f, the filter
+    param[in]       const char * markers, letters of B, A, F, N and O
+
+    return          int, error code
+*/
+int filter_set_markers( record_filter * f, const char * markers )
+    {
+    size_t len = strlen(markers);
+
+    if( ( len == 0 ) || ( len >= FILTER_MARKERS_LEN ) || ( strspn(markers, MARKERS) != len ) )
+        return ERR_FILTER_FORMAT;
+    memcpy(f->markers, markers, len + 1);
+
+    return NOERR;
+    }
+
+
+/*  function        int filter_set_values( record_filter * f, const char * range )
+
+    brief           Sets the values of the records taken from "<min>:<max>",
+                    either may be left out, e.g. "70:180" or ":60".
+
+    param[in/out]   record_filter * f, the filter
+    param[in]       const char * range, the range
+
+    return          int, error code
+*/
+int filter_set_values( record_filter * f, const char * range )
+    {
+    const char * colon = strchr(range, ':');
+    char * end;
+
+    if( colon == 0 )
+        return ERR_FILTER_FORMAT;
+    f->min_value = INT_MIN;
+    f->max_value = INT_MAX;
+    if( colon != range )
+        {
+        f->min_value = (int)strtol(range, &end, 10);
+        if( end != colon )
+            return ERR_FILTER_FORMAT;
+        }
+    if( colon[1] )
+        {
+        f->max_value = (int)strtol(colon + 1, &end, 10);
+        if( *end )
+            return ERR_FILTER_FORMAT;
+        }
+
+    return NOERR;
+    }
+
+
+/*  function        int filter_time( const record_filter * f, long long key )
+
+    brief           Checks the time of a record.
+
+    param[in]       const record_filter * f, the filter
+    param[in]       long long key, the record's time key
+
+    return          int, TRUE if the record may be taken
+*/
+int filter_time( const record_filter * f, long long key )
+    {
+    return ( key >= f->from ) && ( key <= f->until );
+    }
+
+
+/*  function        int filter_type( const record_filter * f, char utid )
+
+    brief           Checks the type of a record by the first letter of its
+                    test id.
+
+    param[in]       const record_filter * f, the filter
+    param[in]       char utid, first letter of the test id
+
+    return          int, TRUE if the record may be taken
+*/
+int filter_type( const record_filter * f, char utid )
+    {
+    if( f->types == 0 )
+        return TRUE;
+
+    switch( utid )
+        {
+        case 'G':
+            return ( f->types & FILTER_GLUCOSE ) != 0;
+        case 'I':
+        case 'W':
+            return ( f->types & FILTER_INSULIN ) != 0;
+        case 'C':
+            return ( f->types & FILTER_CARB ) != 0;
+        default:
+            return FALSE;
+        }
+    }
+
+
+/*  function        int filter_markers( const record_filter * f, const char * flags, size_t len )
+
+    brief           Checks the meal markers of a record, one of the markers
+                    of the filter must be among its flags.
+
+    param[in]       const record_filter * f, the filter
+    param[in]       const char * flags, the record's flags, need no '\0'
+    param[in]       size_t len, number of flags
+
+    return          int, TRUE if the record may be taken
+*/
+int filter_markers( const record_filter * f, const char * flags, size_t len )
+    {
+    size_t i;
+
+    if( *f->markers == 0 )
+        return TRUE;
+
+    for( i = 0; ( i < len ) && flags[i]; ++i )
+        {
+        if( strchr(f->markers, flags[i]) )
+            return TRUE;
+        }
+
+    return FALSE;
+    }
+
+
+/*  function        int filter_value( const record_filter * f, int value )
+
+    brief           Checks the value of a record, insulin is given in tenths
+                    of units.
+
+    param[in]       const record_filter * f, the filter
+    param[in]       int value, the record's value
+
+    return          int, TRUE if the record may be taken
+*/
+int filter_value( const record_filter * f, int value )
+    {
+    return ( value >= f->min_value ) && ( value <= f->max_value );
+    }
+
+
+/*  function        int filter_record( const record_filter * f, const dataset * data )
+
+    brief           Checks a record made already.
+
+    param[in]       const record_filter * f, the filter
+    param[in]       const dataset * data, the record
+
+    return          int, TRUE if the record may be taken
+*/
+int filter_record( const record_filter * f, const dataset * data )
+    {
+    return filter_time(f, data->time_key) && filter_type(f, *data->UTID)
+        && filter_markers(f, data->flags, sizeof(data->flags)) && filter_value(f, data->result);
+    }
@@ -0,0 +1,493 @@
+/*
+    Copyright (C)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+    See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.
+    If not, see <http://www.gnu.org/licenses/>.
+
+    Klabautermann Software
+    Uwe Jantzen
+    Weingartener Straße 33
+    76297 Stutensee
+    Germany
+
+    file        format.c
+
+    date        19.10.2026
+
+    author      Uwe Jantzen (jantzen@klabautermann-software.de)
+
+    brief       Formats records without allocating memory
+
+    details     The record formats write straight into a buffer the caller
+                provides, the buffer must hold at least FORMAT_LINE_LEN
+                bytes. Numbers are converted by hand two digits at a time,
+                there is no printf involved.
+                The field formatters return the position behind the last
+                character written and do not terminate the string, the
+                record formatters do.
+                JSON lines hold one object per record with typed fields :
+                {"time":1546329600,"value":8.5,"unit":"1","flags":"",
+                 "type":"Insulin","record":4}
+                The meter's clock has no time zone, "time" gives its
+                wall-clock time as seconds since the epoch taken as UTC.
+
+    project     glucotux
+    target      Linux
+    begin       03.03.2012
+
+    note
+
+    todo
+
+*/
+
+
+#include <string.h>
+#include "format.h"
+
+
+#define INT_DIGITS                          10                                  // digits of the largest int
+#define LONG_DIGITS                         20                                  // digits of the largest long long
+
+
+static const char digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+
+/*  function        static int _digits( char * end, unsigned int value )
+
+    brief           Converts a number to decimal digits, writing them
+                    backwards in front of <end>.
+
+    param[in]       char * end, position behind the last digit
+    param[in]       unsigned int value, number to convert
+
+    return          int, number of digits written
+*/
+static int _digits( char * end, unsigned int value )
+    {
+    char * p = end;
+
+    while( value >= 100 )
+        {
+        p -= 2;
+        memcpy(p, digit_pairs + 2 * (value % 100), 2);
+        value /= 100;
+        }
+    if( value >= 10 )
+        {
+        p -= 2;
+        memcpy(p, digit_pairs + 2 * value, 2);
+        }
+    else
+        *--p = (char)('0' + value);
+
+    return (int)(end - p);
+    }
+
+
+/*  function        char * format_int( char * dst, int value )
+
+    brief           Writes a number, like "%d".
+
+    param[out]      char * dst, where to write
+    param[in]       int value, number to write
+
+    return          char *, position behind the number
+*/
+char * format_int( char * dst, int value )
+    {
+    return format_int_right(dst, value, 0);
+    }
+
+
+/*  function        char * format_int_right( char * dst, int value, int width )
+
+    brief           Writes a number right aligned in a field of <width>
+                    characters, like "%<width>d".
+
+    param[out]      char * dst, where to write
+    param[in]       int value, number to write
+    param[in]       int width, minimum width of the field
+
+    return          char *, position behind the number
+*/
+char * format_int_right( char * dst, int value, int width )
+    {
+    char digits[INT_DIGITS + 1];
+    unsigned int magnitude = ( value < 0 ) ? 0u - (unsigned int)value : (unsigned int)value;
+    int len;
+
+    len = _digits(digits + sizeof(digits), magnitude);
+    width -= len + ( value < 0 );
+    for( ; width > 0; --width )
+        *dst++ = ' ';
+    if( value < 0 )
+        *dst++ = '-';
+    memcpy(dst, digits + sizeof(digits) - len, (size_t)len);
+
+    return dst + len;
+    }
+
+
+/*  function        char * format_str_left( char * dst, const char * src, int width )
+
+    brief           Writes a string left aligned in a field of <width>
+                    characters, like "%-<width>s".
+
+    param[out]      char * dst, where to write
+    param[in]       const char * src, string to write
+    param[in]       int width, minimum width of the field
+
+    return          char *, position behind the field
+*/
+char * format_str_left( char * dst, const char * src, int width )
+    {
+    while( *src )
+        {
+        *dst++ = *src++;
+        --width;
+        }
+    for( ; width > 0; --width )
+        *dst++ = ' ';
+
+    return dst;
+    }
+
+
+/*  function        char * format_tenths( char * dst, int value, int width, char point )
+
+    brief           Writes a number given in tenths with one decimal, like
+                    "%<width>.1f" of value/10.0 (insulin units). The sign is
+                    written separately, so -5 gives "-0.5".
+
+    param[out]      char * dst, where to write
+    param[in]       int value, number in tenths
+    param[in]       int width, minimum width of the integer part
+    param[in]       char point, decimal separator
+
+    return          char *, position behind the number
+*/
+char * format_tenths( char * dst, int value, int width, char point )
+    {
+    char digits[INT_DIGITS + 1];
+    unsigned int magnitude = ( value < 0 ) ? 0u - (unsigned int)value : (unsigned int)value;
+    int len;
+
+    len = _digits(digits + sizeof(digits), magnitude / 10);
+    width -= len + ( value < 0 );
+    for( ; width > 0; --width )
+        *dst++ = ' ';
+    if( value < 0 )
+        *dst++ = '-';
+    memcpy(dst, digits + sizeof(digits) - len, (size_t)len);
+    dst += len;
+    *dst++ = point;
+    *dst++ = (char)('0' + magnitude % 10);
+
+    return dst;
+    }
+
+
+/*  function        size_t format_line( const dataset * data, char * buffer )
+
+    brief           Formats one record as a line of a data file :
+                    timestamp, value, unit, flags, test id, record type and
+                    record number in fixed width columns.
+
+    param[in]       const dataset * data, record to format
+    param[out]      char * buffer, the line, at least FORMAT_LINE_LEN bytes
+
+    return          size_t, length of the line
+*/
+size_t format_line( const dataset * data, char * buffer )
+    {
+    char * p = buffer;
+
+    p = format_str_left(p, data->timestamp, 14);
+    *p++ = ' ';
+    *p++ = ' ';
+    if( ( *(data->UTID) == 'I' ) || ( *(data->UTID) == 'W' ) )
+        p = format_tenths(p, data->result, 3, '.');
+    else
+        p = format_int_right(p, data->result, 5);
+    *p++ = ' ';
+    *p++ = ' ';
+    p = format_str_left(p, data->unit, 6);
+    *p++ = ' ';
+    *p++ = ' ';
+    p = format_str_left(p, data->flags, 9);
+    *p++ = ' ';
+    *p++ = ' ';
+    p = format_str_left(p, data->UTID, 8);
+    *p++ = ' ';
+    *p++ = ' ';
+    *p++ = data->record_type;
+    *p++ = ' ';
+    *p++ = ' ';
+    p = format_int_right(p, data->record_number, 4);
+    *p++ = '\n';
+    *p = 0;
+
+    return (size_t)(p - buffer);
+    }
+
+
+/*  function        size_t format_csv( const dataset * data, char * buffer )
+
+    brief           Formats one record as a line of a csv file :
+                    date|time|glucose|glucose unit|insulin|insulin type|carb|carb unit|user mark
+
+    param[in]       const dataset * data, record to format
+    param[out]      char * buffer, the line, at least FORMAT_LINE_LEN bytes
+
+    return          size_t, length of the line
+*/
+size_t format_csv( const dataset * data, char * buffer )
+    {
+    char * p = buffer;
+
+    memcpy(p, data->timestamp + 6, 2);                                          // DD.MM.YYYY
+    p += 2;
+    *p++ = '.';
+    memcpy(p, data->timestamp + 4, 2);
+    p += 2;
+    *p++ = '.';
+    memcpy(p, data->timestamp, 4);
+    p += 4;
+    *p++ = '|';
+    memcpy(p, data->timestamp + 8, 2);                                          // hh:mm
+    p += 2;
+    *p++ = ':';
+    memcpy(p, data->timestamp + 10, 2);
+    p += 2;
+    *p++ = '|';
+
+    if( *(data->UTID) == 'G' )
+        {
+        p = format_int(p, data->result);
+        *p++ = '|';
+        p = format_str_left(p, data->unit, 0);
+        }
+    else
+        *p++ = '|';
+    *p++ = '|';
+
+    if( *(data->UTID) == 'I' )
+        {
+        p = format_tenths(p, data->result, 0, ',');
+        *p++ = '|';
+        p = format_str_left(p, data->unit, 0);
+        }
+    else
+        *p++ = '|';
+    *p++ = '|';
+
+    if( *(data->UTID) == 'C' )
+        {
+        p = format_int(p, data->result);
+        *p++ = '|';
+        switch( *(data->unit) )
+            {
+            case '1':
+                p = format_str_left(p, "Gramm", 0);
+                break;
+            case '2':
+                p = format_str_left(p, "BE", 0);
+                break;
+            case '3':
+                p = format_str_left(p, "KE", 0);
+                break;
+            default:
+                break;
+            }
+        }
+    else
+        *p++ = '|';
+    *p++ = '|';
+
+    p = format_str_left(p, data->flags, 0);
+    *p++ = '\n';
+    *p = 0;
+
+    return (size_t)(p - buffer);
+    }
+
+
+/*  function        static int _number( const char * str, int len )
+
+    brief           Converts <len> decimal digits to a number.
+
+    param[in]       const char * str, the digits
+    param[in]       int len, number of digits
+
+    return          int, the number, -1 if there is a character not being a digit
+*/
+static int _number( const char * str, int len )
+    {
+    int value = 0;
+
+    for( ; len > 0; --len, ++str )
+        {
+        if( ( *str < '0' ) || ( *str > '9' ) )
+            return -1;
+        value = value * 10 + (*str - '0');
+        }
+
+    return value;
+    }
+
+
+/*  function        static int _epoch( const char * timestamp, long long * seconds )
+
+    brief           Converts a timestamp YYYYMMDDhhmm or YYYYMMDDhhmmss to
+                    seconds since 1.1.1970 00:00 UTC.
+
+    param[in]       const char * timestamp, the record's timestamp
+    param[out]      long long * seconds, the time
+
+    return          int, 1 if the timestamp is valid, 0 if not
+*/
+static int _epoch( const char * timestamp, long long * seconds )
+    {
+    int year = _number(timestamp, 4);
+    int month = _number(timestamp + 4, 2);
+    int day = _number(timestamp + 6, 2);
+    int hour = _number(timestamp + 8, 2);
+    int minute = _number(timestamp + 10, 2);
+    int second = ( timestamp[12] ) ? _number(timestamp + 12, 2) : 0;
+    long long days;
+    int era;
+    int year_of_era;
+    int day_of_year;
+
+    if( ( year < 0 ) || ( month < 1 ) || ( month > 12 ) || ( day < 1 ) || ( day > 31 )
+            || ( hour < 0 ) || ( minute < 0 ) || ( second < 0 ) )
+        return 0;
+
+    if( month <= 2 )                                                            // the year starts in march, leap day last
+        --year;
+    era = year / 400;
+    year_of_era = year - era * 400;
+    day_of_year = (153 * (month + ( ( month > 2 ) ? -3 : 9 )) + 2) / 5 + day - 1;
+    days = (long long)era * 146097 + year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year - 719468;
+    *seconds = days * 86400 + hour * 3600 + minute * 60 + second;
+
+    return 1;
+    }
+
+
+/*  function        static char * _json_string( char * dst, const char * name, const char * src )
+
+    brief           Writes a member holding a string, escaping what JSON
+                    requires : "name":"src",
+
+    param[out]      char * dst, where to write
+    param[in]       const char * name, the member's name
+    param[in]       const char * src, the string
+
+    return          char *, position behind the member
+*/
+static char * _json_string( char * dst, const char * name, const char * src )
+    {
+    *dst++ = '"';
+    dst = format_str_left(dst, name, 0);
+    *dst++ = '"';
+    *dst++ = ':';
+    *dst++ = '"';
+    for( ; *src; ++src )
+        {
+        if( ( *src == '"' ) || ( *src == '\\' ) )
+            {
+            *dst++ = '\\';
+            *dst++ = *src;
+            }
+        else if( (unsigned char)*src < 0x20 )
+            {
+            memcpy(dst, "\\u00", 4);
+            dst[4] = "0123456789abcdef"[(*src >> 4) & 0x0f];
+            dst[5] = "0123456789abcdef"[*src & 0x0f];
+            dst += 6;
+            }
+        else
+            *dst++ = *src;
+        }
+    *dst++ = '"';
+    *dst++ = ',';
+
+    return dst;
+    }
+
+
+/*  function        size_t format_json( const dataset * data, char * buffer )
+
+    brief           Formats one record as a JSON object on a line of its own.
+
+    param[in]       const dataset * data, record to format
+    param[out]      char * buffer, the line, at least FORMAT_LINE_LEN bytes
+
+    return          size_t, length of the line
+*/
+size_t format_json( const dataset * data, char * buffer )
+    {
+    char digits[LONG_DIGITS + 1];
+    char * p = buffer;
+    long long seconds;
+    unsigned long long magnitude;
+    int len = 0;
+
+    p = format_str_left(p, "{\"time\":", 0);
+    if( _epoch(data->timestamp, &seconds) )
+        {
+        magnitude = ( seconds < 0 ) ? 0ull - (unsigned long long)seconds : (unsigned long long)seconds;
+        do
+            {
+            digits[LONG_DIGITS - len++] = (char)('0' + magnitude % 10);
+            magnitude /= 10;
+            }
+        while( magnitude );
+        if( seconds < 0 )
+            *p++ = '-';
+        memcpy(p, digits + LONG_DIGITS + 1 - len, (size_t)len);
+        p += len;
+        }
+    else
+        p = format_str_left(p, "null", 0);
+
+    p = format_str_left(p, ",\"value\":", 0);
+    if( ( *(data->UTID) == 'I' ) || ( *(data->UTID) == 'W' ) )
+        p = format_tenths(p, data->result, 0, '.');
+    else
+        p = format_int(p, data->result);
+    *p++ = ',';
+    p = _json_string(p, "unit", data->unit);
+    p = _json_string(p, "flags", data->flags);
+    p = _json_string(p, "type", data->UTID);
+    p = format_str_left(p, "\"record\":", 0);
+    p = format_int(p, data->record_number);
+    *p++ = '}';
+    *p++ = '\n';
+    *p = 0;
+
+    return (size_t)(p - buffer);
+    }
@@ -43,6 +43,10 @@
 
 
 #include <unistd.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <glob.h>
+#include <sys/stat.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -51,9 +55,143 @@
 #include "globals.h"
 #include "debug.h"
 #include "utils.h"
+#include "timeindex.h"
 #include "getargs.h"
 
 
+/*  function        static int _is_index( const char * name )
+
+    brief           Returns if a file is the index of a data file, written
+                    next to it, or such an index being written.
+
+    param[in]       const char * name, file name
+
+    return          int, TRUE for an index
+*/
+static int _is_index( const char * name )
+    {
+    static const char * const suffixes[] = { TIME_INDEX_SUFFIX, TIME_INDEX_SUFFIX ".new" };
+    size_t len = strlen(name);
+    size_t suffix_len;
+    size_t k;
+
+    for( k = 0; k < sizeof(suffixes) / sizeof(suffixes[0]); ++k )
+        {
+        suffix_len = strlen(suffixes[k]);
+        if( ( len > suffix_len ) && ( strcmp(name + len - suffix_len, suffixes[k]) == 0 ) )
+            return TRUE;
+        }
+
+    return FALSE;
+    }
+
+
+/*  function        static int _add_infiles( char * arg, int * i )
+
+    brief           Adds the input files given by an -i argument : a file, a
+                    directory whose regular files are all taken, or a
+                    pattern like "dumps/dump*.txt" expanded by glob().
+                    The indexes of data files found are skipped.
+
+    param[in]       char * arg, the argument
+    param[in/out]   int * i, number of input files
+
+    return          int, error code
+*/
+static int _add_infiles( char * arg, int * i )
+    {
+    char pattern[PATH_MAX];
+    struct stat st;
+    glob_t found;
+    size_t j;
+    int result = NOERR;
+
+    if( ( stat(arg, &st) == 0 ) && S_ISDIR(st.st_mode) )
+        snprintf(pattern, sizeof(pattern), "%s/*", arg);
+    else if( strpbrk(arg, "*?[") )
+        snprintf(pattern, sizeof(pattern), "%s", arg);
+    else
+        return set_infile_name(arg, (*i)++);
+
+    if( glob(pattern, 0, 0, &found) != 0 )
+        return ERR_NO_INFILE;
+    for( j = 0; ( j < found.gl_pathc ) && ( result == NOERR ); ++j )
+        {
+        if( ( stat(found.gl_pathv[j], &st) == 0 ) && S_ISREG(st.st_mode) && !_is_index(found.gl_pathv[j]) )
+            {
+            result = set_infile_name(found.gl_pathv[j], (*i)++);
+            set_infile_number(*i);
+            }
+        }
+    globfree(&found);
+
+    return result;
+    }
+
+
+/*  function        static void _set_range( const char * date, int until )
+
+    brief           Sets the start or the end of the time range put out.
+                    Exits program if the date is not valid.
+
+    param[in]       const char * date, the date YYYY[MM[DD[hh[mm[ss]]]]]
+    param[in]       int until, TRUE for the end of the range
+*/
+static void _set_range( const char * date, int until )
+    {
+    long long key;
+    int result;
+
+    result = date_key(date, until, &key);
+    if( result )
+        {
+        showerr(result);
+        exit(1);
+        }
+    if( until )
+        set_range_until(key);
+    else
+        set_range_from(key);
+    }
+
+
+/*  function        static void _set_progress( const char * arg )
+
+    brief           Sets the file descriptor the progress is written to.
+                    Exits program if it is no number or not open.
+
+    param[in]       const char * arg, the file descriptor
+*/
+static void _set_progress( const char * arg )
+    {
+    char * end;
+    long fd = strtol(arg, &end, 10);
+
+    if( ( end == arg ) || *end || ( fd < 0 ) || ( fd > INT_MAX ) || ( fcntl((int)fd, F_GETFD) == -1 ) )
+        {
+        showerr(ERR_PROGRESS_FD);
+        exit(1);
+        }
+    set_progress_fd((int)fd);
+    }
+
+
+/*  function        static void _check_filter( int result )
+
+    brief           Exits program if a filter option is not valid.
+
+    param[in]       int result, error code of setting the filter
+*/
+static void _check_filter( int result )
+    {
+    if( result )
+        {
+        showerr(result);
+        exit(1);
+        }
+    }
+
+
 /*  function        void getargs( int argc, char *argv[] )
 
     brief           Handles command line parameters.
@@ -69,7 +207,7 @@ void getargs( int argc, char *argv[] )
     int option = 0;
 
     debug("Options:\n");
-    while( ( option = getopt(argc, argv, "dvcri:o:h") ) != -1 )
+    while( ( option = getopt(argc, argv, "dvbcjnr:i:o:s:x:p:q:e:a:f:u:y:k:w:m:t:h") ) != -1 )
         {
         switch( option )
             {
@@ -78,18 +216,82 @@ void getargs( int argc, char *argv[] )
                 debug(" -o %s\n", get_outfile_name());
                 break;
             case 'i':
-                showerr(set_infile_name(optarg, i++));
+                showerr(_add_infiles(optarg, &i));
                 set_infile_number(i);
                 break;
+            case 's':
+                showerr(set_capture_name(optarg));
+                debug(" -s %s\n", get_capture_name());
+                break;
+            case 'x':
+                showerr(set_replay_name(optarg));
+                debug(" -x %s\n", get_replay_name());
+                break;
+            case 'q':
+                showerr(set_store_name(optarg));
+                debug(" -q %s\n", get_store_name());
+                break;
+            case 'e':
+                showerr(set_meter_name(optarg));
+                debug(" -e %s\n", get_meter_name());
+                break;
+            case 'a':
+                showerr(set_master_name(optarg));
+                debug(" -a %s\n", get_master_name());
+                break;
+            case 'j':
+                set_json_out(TRUE);
+                debug(" -j\n");
+                break;
+            case 'p':
+                _set_progress(optarg);
+                debug(" -p %d\n", get_progress_fd());
+                break;
+            case 'f':
+                _set_range(optarg, FALSE);
+                debug(" -f %lld\n", get_range_from());
+                break;
+            case 'u':
+                _set_range(optarg, TRUE);
+                debug(" -u %lld\n", get_range_until());
+                break;
+            case 'y':
+                _check_filter(set_filter_types(optarg));
+                debug(" -y %s\n", optarg);
+                break;
+            case 'k':
+                _check_filter(set_filter_markers(optarg));
+                debug(" -k %s\n", optarg);
+                break;
+            case 'w':
+                _check_filter(set_filter_values(optarg));
+                debug(" -w %s\n", optarg);
+                break;
+            case 'm':
+                set_sort_budget(atoi(optarg));
+                debug(" -m %d\n", get_sort_budget());
+                break;
+            case 't':
+                set_threads(atoi(optarg));
+                debug(" -t %d\n", get_threads());
+                break;
             case 'c':
                 set_cvs_out(TRUE);
                 debug(" -c\n");
                 break;
-            case 'r' :
-                set_reformat(1);
+            case 'r':
+                set_reformat(TRUE);
                 showerr(set_infile_name(optarg, i++));
                 set_infile_number(i);
                 break;
+            case 'b':
+                set_benchmark(TRUE);
+                debug(" -b\n");
+                break;
+            case 'n':
+                set_incremental(TRUE);
+                debug(" -n\n");
+                break;
             case 'v':
                 set_verbose(TRUE);
                 debug(" -v\n");
@@ -107,6 +309,12 @@ void getargs( int argc, char *argv[] )
             }
         }
 
+    if( is_incremental() && is_filter() )                                       // the high-water mark would pass filtered records
+        {
+        showerr(ERR_FILTER_INCREMENTAL);
+        exit(1);
+        }
+
     for( j = 0; j < i; ++j )
         debug(" -i %s\n", get_infile_name(j));
     if( is_reformat() )
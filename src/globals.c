@@ -43,9 +43,12 @@
 
 
 #include <stdlib.h>
+#include <limits.h>
 #include <string.h>
 #include "errors.h"
 #include "globals.h"
+#include "filter.h"
+#include "store.h"
 
 
 #define FILENAME_LEN                        1024
@@ -54,10 +57,23 @@
 static int verbose_flag = FALSE;
 static int debug_flag = FALSE;
 static int cvs_out_flag = FALSE;
+static int json_out_flag = FALSE;
 static int reformat_flag = FALSE;
+static int incremental_flag = FALSE;
+static int benchmark_flag = FALSE;
+static int progress_fd = -1;
+static int sort_budget = 0;
+static int threads = 0;
+static record_filter filter = { 0, LLONG_MAX, 0, "", INT_MIN, INT_MAX };       // what records are put out
 static char outfile_name[FILENAME_LEN];
-static char infile_name[2][FILENAME_LEN];
+static char (* infile_name)[FILENAME_LEN] = 0;                                 // grows with the number of input files
+static int infile_capacity = 0;
 static int infile_number = 0;
+static char capture_name[FILENAME_LEN];
+static char replay_name[FILENAME_LEN];
+static char store_name[FILENAME_LEN];
+static char meter_name[STORE_METER_LEN];                                        // meter the records of input files come from
+static char master_name[FILENAME_LEN];
 
 
 /*  function        void init_globals( void )
@@ -67,7 +83,11 @@ static int infile_number = 0;
 void init_globals( void )
     {
     memset(outfile_name, 0, FILENAME_LEN);
-    memset(infile_name, 0, 2 * FILENAME_LEN);
+    memset(capture_name, 0, FILENAME_LEN);
+    memset(replay_name, 0, FILENAME_LEN);
+    memset(store_name, 0, FILENAME_LEN);
+    memset(meter_name, 0, STORE_METER_LEN);
+    memset(master_name, 0, FILENAME_LEN);
     }
 
 
@@ -143,6 +163,30 @@ int is_cvs_out( void )
     }
 
 
+/*  function        void set_json_out( int flag )
+
+    brief           Sets the json_out flag's state
+
+    param[in]       int flag, json_out flag
+*/
+void set_json_out( int flag )
+    {
+    json_out_flag = flag;
+    }
+
+
+/*  function        int is_json_out( void )
+
+    brief           Returns json_out flag's state
+
+    return          int, json_out flag's state
+*/
+int is_json_out( void )
+    {
+    return json_out_flag;
+    }
+
+
 /*  function        void set_reformat( int flag )
 
     brief           Sets the reformat flag's state
@@ -167,6 +211,253 @@ int is_reformat( void )
     }
 
 
+/*  function        void set_incremental( int flag )
+
+    brief           Sets the incremental flag's state
+
+    param[in]       int flag, incremental flag
+*/
+void set_incremental( int flag )
+    {
+    incremental_flag = flag;
+    }
+
+
+/*  function        int is_incremental( void )
+
+    brief           Returns incremental flag's state
+
+    return          int, incremental flag's state
+*/
+int is_incremental( void )
+    {
+    return incremental_flag;
+    }
+
+
+/*  function        void set_benchmark( int flag )
+
+    brief           Sets the benchmark flag's state
+
+    param[in]       int flag, benchmark flag
+*/
+void set_benchmark( int flag )
+    {
+    benchmark_flag = flag;
+    }
+
+
+/*  function        int is_benchmark( void )
+
+    brief           Returns benchmark flag's state
+
+    return          int, benchmark flag's state
+*/
+int is_benchmark( void )
+    {
+    return benchmark_flag;
+    }
+
+
+/*  function        void set_progress_fd( int fd )
+
+    brief           Sets the file descriptor the progress is written to
+
+    param[in]       int fd, file descriptor, -1 : none
+*/
+void set_progress_fd( int fd )
+    {
+    progress_fd = fd;
+    }
+
+
+/*  function        int get_progress_fd( void )
+
+    brief           Returns the file descriptor the progress is written to
+
+    return          int, file descriptor, -1 : none
+*/
+int get_progress_fd( void )
+    {
+    return progress_fd;
+    }
+
+
+/*  function        void set_sort_budget( int megabytes )
+
+    brief           Sets the memory a file may use to be sorted
+
+    param[in]       int megabytes, memory in MB, 0 : no limit
+*/
+void set_sort_budget( int megabytes )
+    {
+    sort_budget = ( megabytes > 0 ) ? megabytes : 0;
+    }
+
+
+/*  function        int get_sort_budget( void )
+
+    brief           Returns the memory a file may use to be sorted
+
+    return          int, memory in MB, 0 : no limit
+*/
+int get_sort_budget( void )
+    {
+    return sort_budget;
+    }
+
+
+/*  function        void set_range_from( long long key )
+
+    brief           Sets the time of the first record put out
+
+    param[in]       long long key, time key YYYYMMDDhhmmss
+*/
+void set_range_from( long long key )
+    {
+    filter.from = key;
+    }
+
+
+/*  function        long long get_range_from( void )
+
+    brief           Returns the time of the first record put out
+
+    return          long long, time key, 0 : no limit
+*/
+long long get_range_from( void )
+    {
+    return filter.from;
+    }
+
+
+/*  function        void set_range_until( long long key )
+
+    brief           Sets the time of the last record put out
+
+    param[in]       long long key, time key YYYYMMDDhhmmss
+*/
+void set_range_until( long long key )
+    {
+    filter.until = key;
+    }
+
+
+/*  function        long long get_range_until( void )
+
+    brief           Returns the time of the last record put out
+
+    return          long long, time key, LLONG_MAX : no limit
+*/
+long long get_range_until( void )
+    {
+    return filter.until;
+    }
+
+
+/*  function        int is_range( void )
+
+    brief           Returns if only records of a time range are put out
+
+    return          int, TRUE if a range is set
+*/
+int is_range( void )
+    {
+    return ( filter.from != 0 ) || ( filter.until != LLONG_MAX );
+    }
+
+
+/*  function        int set_filter_types( const char * names )
+
+    brief           Sets the types of the records put out
+
+    param[in]       const char * names, e.g. "Glucose,Carb"
+
+    return          int, error code
+*/
+int set_filter_types( const char * names )
+    {
+    return filter_set_types(&filter, names);
+    }
+
+
+/*  function        int set_filter_markers( const char * markers )
+
+    brief           Sets the meal markers of the records put out
+
+    param[in]       const char * markers, e.g. "BA"
+
+    return          int, error code
+*/
+int set_filter_markers( const char * markers )
+    {
+    return filter_set_markers(&filter, markers);
+    }
+
+
+/*  function        int set_filter_values( const char * range )
+
+    brief           Sets the values of the records put out
+
+    param[in]       const char * range, "<min>:<max>"
+
+    return          int, error code
+*/
+int set_filter_values( const char * range )
+    {
+    return filter_set_values(&filter, range);
+    }
+
+
+/*  function        const record_filter * get_filter( void )
+
+    brief           Returns the filter of the records put out, time range
+                    included
+
+    return          const record_filter *, the filter
+*/
+const record_filter * get_filter( void )
+    {
+    return &filter;
+    }
+
+
+/*  function        int is_filter( void )
+
+    brief           Returns if records may be filtered out
+
+    return          int, TRUE if any filter is set
+*/
+int is_filter( void )
+    {
+    return filter_is_set(&filter);
+    }
+
+
+/*  function        void set_threads( int number )
+
+    brief           Sets the number of threads files are read with
+
+    param[in]       int number, number of threads, 0 : one per processor
+*/
+void set_threads( int number )
+    {
+    threads = ( number > 0 ) ? number : 0;
+    }
+
+
+/*  function        int get_threads( void )
+
+    brief           Returns the number of threads files are read with
+
+    return          int, number of threads, 0 : one per processor
+*/
+int get_threads( void )
+    {
+    return threads;
+    }
+
+
 /*  function        int set_outfile_name( char * filename )
 
     brief           Sets the the output file's name from filename.
@@ -203,6 +494,8 @@ char const *  get_outfile_name( void )
 /*  function        int set_infile_name( char * filename, int i )
 
     brief           Sets the input file's name from filename.
+                    The list of names grows as needed, names are set in
+                    the order of the input files.
 
     param[in]       char * filename, input file's name
     param[in]       int i, index of input file
@@ -212,34 +505,51 @@ char const *  get_outfile_name( void )
 int set_infile_name( char * filename, int i )
     {
     size_t len = strlen(filename);
+    char (* names)[FILENAME_LEN];
+    int capacity;
 
-    if( i > 1 )
+    if( ( i < 0 ) || ( i > infile_number ) )
         return ERR_NUM_OF_INFILES;
 
     if( len > FILENAME_LEN - 1 )
         return ERR_FILE_NAME_LENGTH;
 
+    if( i >= infile_capacity )
+        {
+        capacity = infile_capacity ? 2 * infile_capacity : 4;
+        names = realloc(infile_name, (size_t)capacity * FILENAME_LEN);
+        if( names == 0 )
+            return ERR_NOT_ENOUGH_MEMORY;
+        memset(names + infile_capacity, 0, (size_t)(capacity - infile_capacity) * FILENAME_LEN);
+        infile_name = names;
+        infile_capacity = capacity;
+        }
+
     memcpy(infile_name[i], filename, len + 1);
 
     return NOERR;
     }
 
 
-/*  function        char const *  set_infile_name( int i )
+/*  function        char const *  get_infile_name( int i )
 
-    brief           Returns the pointer to the i'th input file's name.
+    brief           Returns the pointer to the i'th input file's name, an
+                    empty name if there are less input files.
                     Exits program on error!
 
     return          char const *, pointer to the input file's name
 */
 char const *  get_infile_name( int i )
     {
-    if( i > 1 )
+    if( i < 0 )
         {
         showerr(ERR_NUM_OF_INFILES);
         exit(ERR_NUM_OF_INFILES);
         }
 
+    if( ( i >= infile_number ) || ( i >= infile_capacity ) )
+        return "";
+
     return infile_name[i];
     }
 
@@ -268,3 +578,171 @@ int const get_infile_number( void )
     {
     return infile_number;
     }
+
+
+/*  function        int set_capture_name( char * filename )
+
+    brief           Sets the name of the file to save the raw capture of a
+                    download to.
+
+    param[in]       char * filename, raw capture file's name
+
+    return          int, error code
+*/
+int set_capture_name( char * filename )
+    {
+    size_t len = strlen(filename);
+
+    if( len > FILENAME_LEN - 1 )
+        return ERR_FILE_NAME_LENGTH;
+
+    memcpy(capture_name, filename, len + 1);
+
+    return NOERR;
+    }
+
+
+/*  function        char const *  get_capture_name( void )
+
+    brief           Return the pointer to the raw capture file's name.
+
+    return          char const *, pointer to the raw capture file's name
+*/
+char const *  get_capture_name( void )
+    {
+    return capture_name;
+    }
+
+
+/*  function        int set_replay_name( char * filename )
+
+    brief           Sets the name of the raw capture file to decode offline.
+
+    param[in]       char * filename, raw capture file's name
+
+    return          int, error code
+*/
+int set_replay_name( char * filename )
+    {
+    size_t len = strlen(filename);
+
+    if( len > FILENAME_LEN - 1 )
+        return ERR_FILE_NAME_LENGTH;
+
+    memcpy(replay_name, filename, len + 1);
+
+    return NOERR;
+    }
+
+
+/*  function        char const *  get_replay_name( void )
+
+    brief           Return the pointer to the name of the raw capture file to
+                    decode offline.
+
+    return          char const *, pointer to the raw capture file's name
+*/
+char const *  get_replay_name( void )
+    {
+    return replay_name;
+    }
+
+
+/*  function        int set_store_name( char * filename )
+
+    brief           Sets the name of the SQLite database to store records in.
+
+    param[in]       char * filename, database's name
+
+    return          int, error code
+*/
+int set_store_name( char * filename )
+    {
+    size_t len = strlen(filename);
+
+    if( len > FILENAME_LEN - 1 )
+        return ERR_FILE_NAME_LENGTH;
+
+    memcpy(store_name, filename, len + 1);
+
+    return NOERR;
+    }
+
+
+/*  function        char const *  get_store_name( void )
+
+    brief           Return the pointer to the database's name.
+
+    return          char const *, pointer to the database's name
+*/
+char const *  get_store_name( void )
+    {
+    return store_name;
+    }
+
+
+/*  function        int set_meter_name( char * serial )
+
+    brief           Sets the serial number of the meter the records of the
+                    input files are stored for.
+
+    param[in]       char * serial, meter's serial number
+
+    return          int, error code
+*/
+int set_meter_name( char * serial )
+    {
+    size_t len = strlen(serial);
+
+    if( len > STORE_METER_LEN - 1 )
+        return ERR_METER_NAME;
+
+    memcpy(meter_name, serial, len + 1);
+
+    return NOERR;
+    }
+
+
+/*  function        char const *  get_meter_name( void )
+
+    brief           Return the pointer to the meter's serial number.
+
+    return          char const *, pointer to the meter's serial number
+*/
+char const *  get_meter_name( void )
+    {
+    return meter_name;
+    }
+
+
+/*  function        int set_master_name( char * filename )
+
+    brief           Sets the directory of the master history.
+
+    param[in]       char * filename, directory's name
+
+    return          int, error code
+*/
+int set_master_name( char * filename )
+    {
+    size_t len = strlen(filename);
+
+    if( len > FILENAME_LEN - 1 )
+        return ERR_FILE_NAME_LENGTH;
+
+    memcpy(master_name, filename, len + 1);
+
+    return NOERR;
+    }
+
+
+/*  function        char const *  get_master_name( void )
+
+    brief           Return the pointer to the master history's directory.
+
+    return          char const *, pointer to the directory's name
+*/
+char const *  get_master_name( void )
+    {
+    return master_name;
+    }
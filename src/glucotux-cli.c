@@ -53,6 +53,7 @@
 #include "contour.h"
 #include "astm.h"
 #include "files.h"
+#include "bench.h"
 
 
 /*  function        int main( int argc, char *argv[] )
@@ -72,18 +73,38 @@ int main( int argc, char *argv[] )
     int result = NOERR;
     int handle;
     int contour_type;
+    const contour_profile * profile;
     char c;
 
     printf(title, name, version_cli, commitdate);
     void init_globals();
     getargs(argc, argv);
 
+    if( is_benchmark() )
+        return benchmark();
+
+    if( strlen(get_replay_name()) != 0 )
+        {
+        result = decode_capture(get_replay_name());
+        showerr(result);
+        return result;
+        }
+
+    if( strlen(get_master_name()) != 0 )
+        return masterfiles(get_master_name(), get_outfile_name());
+
     if( strlen(get_infile_name(0)) != 0 )
         {
-        if( is_cvs_out() )
-            csvformat(get_infile_name(0), get_outfile_name());
+        if( ( get_infile_number() > 1 ) || is_range() )
+            result = mixfiles(get_outfile_name());
+        else if( is_reformat() )
+            result = reformat(get_infile_name(0), get_outfile_name());
+        else if( is_cvs_out() )
+            result = csvformat(get_infile_name(0), get_outfile_name());
+        else if( is_json_out() )
+            result = jsonformat(get_infile_name(0), get_outfile_name());
         else
-            mixfiles(get_infile_name(0), get_infile_name(1), get_outfile_name());
+            result = mixfiles(get_outfile_name());
         return result;
         }
 
@@ -93,20 +114,16 @@ int main( int argc, char *argv[] )
     if( handle < 0 )
         exit(handle);
 
-    switch( contour_type )
+    profile = get_contour_profile(contour_type);
+    if( profile == 0 )                                                          // unknown glucometer
+        goto finish;
+    if( profile->wait_for_enq )
         {
-        case CONTOUR_USB_CODE:
-            c = read_astm(handle);
-            if( c != ENQ )
-                goto finish;
-        case CONTOUR_USB_NEXT_CODE:
-            usleep(5 * 1000 * 1000);
-            break;
-        case CONTOUR_NEXT_ONE:
-            break;
-        default:                                                                // unknown glucometer
+        c = read_astm(handle);
+        if( c != ENQ )
             goto finish;
         }
+    usleep(profile->startup_delay_ms * 1000);
 
     result = data_transfer_mode(handle, contour_type);
     if( result )
@@ -0,0 +1,546 @@
+/*
+    Copyright (C)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+    See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.
+    If not, see <http://www.gnu.org/licenses/>.
+
+    Klabautermann Software
+    Uwe Jantzen
+    Weingartener Straße 33
+    76297 Stutensee
+    Germany
+
+    file        gtx.c
+
+    date        19.10.2026
+
+    author      Uwe Jantzen (jantzen@klabautermann-software.de)
+
+    brief       Binary columnar record files (.gtx)
+
+    details     Written block by block while the records come in, read through
+                mmap() without parsing. The layout is described in gtx.h.
+
+    project     glucotux
+    target      Linux
+    begin       03.03.2012
+
+    note
+
+    todo
+
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <assert.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "errors.h"
+#include "debug.h"
+#include "globals.h"
+#include "utils.h"
+#include "astm.h"
+#include "columns.h"
+#include "gtx.h"
+
+
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+ #error ".gtx files are little endian, a conversion is needed on this target"
+#endif
+
+#define PAD8(n)                             (((n) + 7) & ~(size_t)7)
+
+
+/*  function        static size_t _block_len( size_t count )
+
+    brief           Returns the number of bytes of a block.
+
+    param[in]       size_t count, number of records in the block
+
+    return          size_t, number of bytes
+*/
+static size_t _block_len( size_t count )
+    {
+    return 3 * PAD8(count * 4) + 5 * PAD8(count);
+    }
+
+
+/*  function        int gtx_is_name( const char * name )
+
+    brief           Returns if a file is to be written as .gtx file, given
+                    by its name's extension.
+
+    param[in]       const char * name, file name
+
+    return          int, TRUE for a .gtx file
+*/
+int gtx_is_name( const char * name )
+    {
+    size_t len = strlen(name);
+
+    return ( len > 4 ) && ( strcmp(name + len - 4, ".gtx") == 0 );
+    }
+
+
+/*  function        int gtx_is_file( const char * name )
+
+    brief           Returns if a file is a .gtx file, given by its magic.
+
+    param[in]       const char * name, file name
+
+    return          int, TRUE for a .gtx file
+*/
+int gtx_is_file( const char * name )
+    {
+    char magic[sizeof(GTX_MAGIC)];
+    ssize_t n;
+    int fd;
+
+    fd = open(name, O_RDONLY);
+    if( fd < 0 )
+        return FALSE;
+    n = pread(fd, magic, sizeof(magic), 0);
+    close(fd);
+
+    return ( n == (ssize_t)sizeof(magic) ) && ( memcmp(magic, GTX_MAGIC, sizeof(magic)) == 0 );
+    }
+
+
+/*  function        int gtx_open( gtx * g, const char * name )
+
+    brief           Maps a .gtx file into memory and checks that its index,
+                    blocks and dictionaries are inside the file.
+
+    param[out]      gtx * g, the opened file
+    param[in]       const char * name, file name
+
+    return          int, error code
+*/
+int gtx_open( gtx * g, const char * name )
+    {
+    struct stat st;
+    size_t end;
+    size_t b;
+    int fd;
+    int i;
+    assert(g);
+
+    memset(g, 0, sizeof(gtx));
+    fd = open(name, O_RDONLY);
+    if( fd < 0 )
+        return errno;
+    if( ( fstat(fd, &st) != 0 ) || ( (size_t)st.st_size < sizeof(gtx_header) ) )
+        {
+        close(fd);
+        return ERR_GTX_FORMAT;
+        }
+    g->size = (size_t)st.st_size;
+    g->map = (const char *)mmap(0, g->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);                                                                  // the mapping stays
+    if( g->map == MAP_FAILED )
+        {
+        g->map = 0;
+        return ERR_MAP_FILE;
+        }
+
+    g->header = (const gtx_header *)g->map;
+    if( ( memcmp(g->header->magic, GTX_MAGIC, sizeof(GTX_MAGIC)) != 0 ) || ( g->header->version != GTX_VERSION )
+            || ( g->header->index_offset > g->size ) || ( g->header->index_offset % 8 )
+            || ( g->header->blocks > ( g->size - g->header->index_offset ) / sizeof(gtx_block_info) ) )
+        goto format_err;
+    end = g->header->index_offset + g->header->blocks * sizeof(gtx_block_info);
+    for( i = 0; i < 3; ++i )
+        {
+        if( g->header->codes[i] > COLUMN_CODES )
+            goto format_err;
+        g->names[i] = (const char (*)[GTX_NAME_LEN])(g->map + end);
+        end += g->header->codes[i] * GTX_NAME_LEN;
+        }
+    if( end > g->size )
+        goto format_err;
+
+    g->blocks = (const gtx_block_info *)(g->map + g->header->index_offset);
+    for( b = 0, end = 0; b < g->header->blocks; ++b )
+        {
+        if( ( g->blocks[b].count > g->header->block_records ) || ( g->blocks[b].offset % 8 )
+                || ( g->blocks[b].offset < sizeof(gtx_header) ) || ( g->blocks[b].offset > g->header->index_offset )
+                || ( _block_len(g->blocks[b].count) > g->header->index_offset - g->blocks[b].offset ) )
+            goto format_err;
+        end += g->blocks[b].count;
+        }
+    if( end != g->header->records )
+        goto format_err;
+
+    debug("%s : %lu records in %lu blocks\n", name, (unsigned long)g->header->records, (unsigned long)g->header->blocks);
+    return NOERR;
+
+format_err:
+    gtx_close(g);
+    return ERR_GTX_FORMAT;
+    }
+
+
+/*  function        void gtx_close( gtx * g )
+
+    brief           Unmaps a .gtx file.
+
+    param[in/out]   gtx * g, the file
+*/
+void gtx_close( gtx * g )
+    {
+    if( g->map )
+        munmap((void *)g->map, g->size);
+    memset(g, 0, sizeof(gtx));
+    }
+
+
+/*  function        size_t gtx_records( const gtx * g )
+
+    brief           Returns the number of records of a .gtx file.
+
+    param[in]       const gtx * g, the file
+
+    return          size_t, number of records
+*/
+size_t gtx_records( const gtx * g )
+    {
+    return (size_t)g->header->records;
+    }
+
+
+/*  function        void gtx_get_block( const gtx * g, size_t b, gtx_block * block )
+
+    brief           Returns the columns of a block, pointing into the file.
+
+    param[in]       const gtx * g, the file
+    param[in]       size_t b, number of the block
+    param[out]      gtx_block * block, the columns
+*/
+void gtx_get_block( const gtx * g, size_t b, gtx_block * block )
+    {
+    const gtx_block_info * info = g->blocks + b;
+    const char * p = g->map + info->offset;
+    size_t n = info->count;
+    assert(b < g->header->blocks);
+
+    block->base = info->min_time;
+    block->count = n;
+    block->time = (const uint32_t *)p;
+    p += PAD8(n * 4);
+    block->value = (const int32_t *)p;
+    p += PAD8(n * 4);
+    block->number = (const int32_t *)p;
+    p += PAD8(n * 4);
+    block->type = (const unsigned char *)p;
+    p += PAD8(n);
+    block->unit = (const unsigned char *)p;
+    p += PAD8(n);
+    block->flags = (const unsigned char *)p;
+    p += PAD8(n);
+    block->record_type = p;
+    p += PAD8(n);
+    block->digits = (const unsigned char *)p;
+    }
+
+
+/*  function        static void _name( const gtx * g, int dictionary, unsigned char code, char * dst, size_t size )
+
+    brief           Copies the string of a code, an unknown code gives "".
+
+    param[in]       const gtx * g, the file
+    param[in]       int dictionary, 0 : types, 1 : units, 2 : flags
+    param[in]       unsigned char code, the code
+    param[out]      char * dst, the string
+    param[in]       size_t size, size of dst
+*/
+static void _name( const gtx * g, int dictionary, unsigned char code, char * dst, size_t size )
+    {
+    if( code < g->header->codes[dictionary] )
+        strncpy(dst, g->names[dictionary][code], size - 1);
+    }
+
+
+/*  function        void gtx_get( const gtx * g, const gtx_block * block, size_t i, dataset * data )
+
+    brief           Returns record <i> of a block as a dataset.
+
+    param[in]       const gtx * g, the file
+    param[in]       const gtx_block * block, the block's columns
+    param[in]       size_t i, the record's index in the block
+    param[out]      dataset * data, the record
+*/
+void gtx_get( const gtx * g, const gtx_block * block, size_t i, dataset * data )
+    {
+    int digits = block->digits[i];
+    assert(i < block->count);
+
+    memset(data, 0, sizeof(dataset));
+    data->time_key = block->base + block->time[i];
+    key_timestamp(data->timestamp, data->time_key, ( digits < (int)sizeof(data->timestamp) ) ? digits : 14);
+    data->result = block->value[i];
+    data->record_number = block->number[i];
+    data->record_type = block->record_type[i];
+    _name(g, 0, block->type[i], data->UTID, sizeof(data->UTID));
+    _name(g, 1, block->unit[i], data->unit, sizeof(data->unit));
+    _name(g, 2, block->flags[i], data->flags, sizeof(data->flags));
+    }
+
+
+/*  function        void gtx_find( const gtx * g, long long time, size_t * b, size_t * i )
+
+    brief           Finds the first record at or after <time> by binary
+                    searches over the blocks and in the block found.
+
+    param[in]       const gtx * g, the file
+    param[in]       long long time, the time key
+    param[out]      size_t * b, the record's block, number of blocks if none
+    param[out]      size_t * i, the record's index in the block
+*/
+void gtx_find( const gtx * g, long long time, size_t * b, size_t * i )
+    {
+    gtx_block block;
+    size_t low = 0;
+    size_t high = g->header->blocks;
+    size_t middle;
+
+    while( low < high )                                                         // first block ending at or after time
+        {
+        middle = low + ( high - low ) / 2;
+        if( g->blocks[middle].max_time < time )
+            low = middle + 1;
+        else
+            high = middle;
+        }
+    *b = low;
+    *i = 0;
+    if( ( low == g->header->blocks ) || ( g->blocks[low].min_time >= time ) )
+        return;
+
+    gtx_get_block(g, low, &block);
+    high = block.count;
+    while( *i < high )
+        {
+        middle = *i + ( high - *i ) / 2;
+        if( block.base + block.time[middle] < time )
+            *i = middle + 1;
+        else
+            high = middle;
+        }
+    }
+
+
+/*  function        static int _write_column( gtx_writer * w, const void * column, size_t len )
+
+    brief           Writes a column padded to 8 bytes.
+
+    param[in/out]   gtx_writer * w, the file
+    param[in]       const void * column, the column
+    param[in]       size_t len, number of bytes
+
+    return          int, error code
+*/
+static int _write_column( gtx_writer * w, const void * column, size_t len )
+    {
+    static const char zeros[8] = { 0 };
+
+    if( ( fwrite(column, 1, len, w->f) != len ) || ( fwrite(zeros, 1, PAD8(len) - len, w->f) != PAD8(len) - len ) )
+        return ERR_WRITE_TO_FILE;
+    w->offset += PAD8(len);
+
+    return NOERR;
+    }
+
+
+/*  function        static int _flush_block( gtx_writer * w )
+
+    brief           Writes the block filled and adds it to the index.
+
+    param[in/out]   gtx_writer * w, the file
+
+    return          int, error code
+*/
+static int _flush_block( gtx_writer * w )
+    {
+    columns * c = &w->block;
+    gtx_block_info * info;
+    size_t i;
+    int result = NOERR;
+
+    if( c->count == 0 )
+        return NOERR;
+    if( w->blocks == w->index_capacity )
+        {
+        info = (gtx_block_info *)realloc(w->index, ( w->index_capacity + 64 ) * sizeof(gtx_block_info));
+        if( info == 0 )
+            return ERR_NOT_ENOUGH_MEMORY;
+        w->index = info;
+        w->index_capacity += 64;
+        }
+    info = w->index + w->blocks++;
+    memset(info, 0, sizeof(gtx_block_info));
+    info->offset = w->offset;
+    info->min_time = c->time[0];
+    info->max_time = c->time[c->count - 1];
+    info->count = (uint32_t)c->count;
+
+    for( i = 0; i < c->count; ++i )
+        w->time[i] = (uint32_t)(c->time[i] - c->time[0]);
+    if( result == NOERR )
+        result = _write_column(w, w->time, c->count * 4);
+    if( result == NOERR )
+        result = _write_column(w, c->value, c->count * 4);
+    if( result == NOERR )
+        result = _write_column(w, c->number, c->count * 4);
+    if( result == NOERR )
+        result = _write_column(w, c->type, c->count);
+    if( result == NOERR )
+        result = _write_column(w, c->unit, c->count);
+    if( result == NOERR )
+        result = _write_column(w, c->flags, c->count);
+    if( result == NOERR )
+        result = _write_column(w, c->record_type, c->count);
+    if( result == NOERR )
+        result = _write_column(w, c->digits, c->count);
+    w->records += c->count;
+    c->count = 0;                                                               // the dictionaries are kept
+
+    return result;
+    }
+
+
+/*  function        int gtx_create( gtx_writer * w, const char * name )
+
+    brief           Creates a .gtx file, the header is written when it is
+                    finished.
+
+    param[out]      gtx_writer * w, the file
+    param[in]       const char * name, file name
+
+    return          int, error code
+*/
+int gtx_create( gtx_writer * w, const char * name )
+    {
+    gtx_header header;
+    int result;
+    assert(w);
+
+    memset(w, 0, sizeof(gtx_writer));
+    result = columns_init(&w->block, GTX_BLOCK_RECORDS);
+    if( result )
+        return result;
+    w->time = (uint32_t *)malloc(GTX_BLOCK_RECORDS * sizeof(uint32_t));
+    w->f = fopen(name, "w");
+    if( ( w->time == 0 ) || ( w->f == 0 ) )
+        {
+        result = ( w->f == 0 ) ? errno : ERR_NOT_ENOUGH_MEMORY;
+        if( w->f )
+            fclose(w->f);
+        free(w->time);
+        columns_free(&w->block);
+        return result;
+        }
+
+    memset(&header, 0, sizeof(header));                                        // a file not finished has no magic
+    if( fwrite(&header, sizeof(header), 1, w->f) != 1 )
+        return gtx_finish(w, ERR_WRITE_TO_FILE);
+    w->offset = sizeof(header);
+
+    return result;
+    }
+
+
+/*  function        int gtx_write( gtx_writer * w, const dataset * data )
+
+    brief           Adds a record to a .gtx file. A block ends if it is full
+                    or the record's time is too far from the block's first.
+
+    param[in/out]   gtx_writer * w, the file
+    param[in]       const dataset * data, the record, not earlier than the one before
+
+    return          int, error code
+*/
+int gtx_write( gtx_writer * w, const dataset * data )
+    {
+    columns * c = &w->block;
+    int result = NOERR;
+
+    if( c->count && ( data->time_key < c->time[c->count - 1] ) )
+        return ERR_GTX_ORDER;
+    if( ( c->count == GTX_BLOCK_RECORDS ) || ( c->count && ( data->time_key - c->time[0] > UINT32_MAX ) ) )
+        result = _flush_block(w);
+    if( result == NOERR )
+        result = columns_add(c, data);
+
+    return result;
+    }
+
+
+/*  function        int gtx_finish( gtx_writer * w, int result )
+
+    brief           Writes the last block, the index, the dictionaries and
+                    the header and closes the file.
+
+    param[in/out]   gtx_writer * w, the file
+    param[in]       int result, error code so far, on error the file is closed only
+
+    return          int, error code
+*/
+int gtx_finish( gtx_writer * w, int result )
+    {
+    gtx_header header;
+    columns * c = &w->block;
+    const dictionary * dictionaries[3] = { &c->types, &c->units, &c->flag_strings };
+    size_t len;
+    int i;
+
+    if( result == NOERR )
+        result = _flush_block(w);
+    memset(&header, 0, sizeof(header));
+    header.index_offset = w->offset;
+    len = w->blocks * sizeof(gtx_block_info);
+    if( ( result == NOERR ) && ( fwrite(w->index, 1, len, w->f) != len ) )
+        result = ERR_WRITE_TO_FILE;
+    for( i = 0; ( i < 3 ) && ( result == NOERR ); ++i )
+        {
+        header.codes[i] = dictionaries[i]->count;
+        len = dictionaries[i]->count * GTX_NAME_LEN;
+        if( fwrite(dictionaries[i]->names, 1, len, w->f) != len )
+            result = ERR_WRITE_TO_FILE;
+        }
+
+    if( result == NOERR )
+        {
+        memcpy(header.magic, GTX_MAGIC, sizeof(GTX_MAGIC));
+        header.version = GTX_VERSION;
+        header.block_records = GTX_BLOCK_RECORDS;
+        header.records = w->records;
+        header.blocks = w->blocks;
+        if( ( fseek(w->f, 0, SEEK_SET) != 0 ) || ( fwrite(&header, sizeof(header), 1, w->f) != 1 ) )
+            result = ERR_WRITE_TO_FILE;
+        }
+    if( ( fclose(w->f) != 0 ) && ( result == NOERR ) )
+        result = ERR_WRITE_TO_FILE;
+
+    free(w->time);
+    free(w->index);
+    columns_free(&w->block);
+    memset(w, 0, sizeof(gtx_writer));
+
+    return result;
+    }
@@ -0,0 +1,409 @@
+/*
+    Copyright (C)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+    See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.
+    If not, see <http://www.gnu.org/licenses/>.
+
+    Klabautermann Software
+    Uwe Jantzen
+    Weingartener Straße 33
+    76297 Stutensee
+    Germany
+
+    file        master.c
+
+    date        19.10.2026
+
+    author      Uwe Jantzen (jantzen@klabautermann-software.de)
+
+    brief       Master history : append-only .gtx segments and a manifest
+
+    details     A master history is a directory of .gtx segments, each
+                sorted by time, and a manifest naming them, one line per
+                segment : name, number of records, first and last time key.
+                Segments are never rewritten. New records are checked for
+                duplicates against the segments overlapping their time
+                range only, and those not known yet are written to a new
+                segment. The segment is complete when its manifest line is,
+                a line cut short by a crash is ignored when read, so the
+                cost of appending grows with the new records, not with
+                the history.
+
+    project     glucotux
+    target      Linux
+    begin       03.03.2012
+
+    note
+
+    todo
+
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include "errors.h"
+#include "debug.h"
+#include "globals.h"
+#include "astm.h"
+#include "dedup.h"
+#include "gtx.h"
+#include "master.h"
+
+
+/*  function        static int _add_segment( master * m, const master_segment * segment )
+
+    brief           Adds a segment to the list of the master's segments.
+
+    param[in/out]   master * m, the master history
+    param[in]       const master_segment * segment, the segment
+
+    return          int, error code
+*/
+static int _add_segment( master * m, const master_segment * segment )
+    {
+    master_segment * segments;
+    size_t capacity;
+
+    if( m->count == m->capacity )
+        {
+        capacity = m->capacity ? 2 * m->capacity : 16;
+        segments = (master_segment *)realloc(m->segments, capacity * sizeof(master_segment));
+        if( segments == 0 )
+            return ERR_NOT_ENOUGH_MEMORY;
+        m->segments = segments;
+        m->capacity = capacity;
+        }
+    m->segments[m->count++] = *segment;
+
+    return NOERR;
+    }
+
+
+/*  function        static int _read_manifest( master * m, FILE * f )
+
+    brief           Reads the segments of the master from its manifest.
+                    A last line without line feed was cut short while
+                    written and is ignored, the next segment's line will
+                    replace it.
+
+    param[in/out]   master * m, the master history
+    param[in]       FILE * f, the manifest
+
+    return          int, error code
+*/
+static int _read_manifest( master * m, FILE * f )
+    {
+    int result = NOERR;
+    master_segment segment;
+    char * line = 0;
+    size_t line_len = 0;
+    ssize_t n;
+
+    while( ( result == NOERR ) && ( ( n = getline(&line, &line_len, f) ) != -1 ) ) // getline allocates memory for "line"
+        {
+        if( line[n - 1] != '\n' )
+            break;
+        m->length += n;
+        memset(&segment, 0, sizeof(segment));
+        if( sscanf(line, "%31s %zu %lld %lld", segment.name, &segment.records, &segment.min_time, &segment.max_time) != 4 )
+            result = ERR_MASTER_FORMAT;
+        else
+            result = _add_segment(m, &segment);
+        }
+
+    free(line);
+    return result;
+    }
+
+
+/*  function        int master_open( master * m, const char * path )
+
+    brief           Opens the master history in the directory <path>,
+                    which is created if it does not exist.
+
+    param[out]      master * m, the master history
+    param[in]       const char * path, the master's directory
+
+    return          int, error code
+*/
+int master_open( master * m, const char * path )
+    {
+    char name[MASTER_PATH_LEN];
+    FILE * f;
+    int result;
+
+    memset(m, 0, sizeof(master));
+    if( strlen(path) + sizeof(MASTER_MANIFEST) + 1 > MASTER_PATH_LEN )
+        return ERR_FILE_NAME_LENGTH;
+    strcpy(m->path, path);
+
+    if( ( mkdir(path, 0755) != 0 ) && ( errno != EEXIST ) )
+        return errno;
+    snprintf(name, MASTER_PATH_LEN, "%s/%s", path, MASTER_MANIFEST);
+    f = fopen(name, "r");
+    if( f == 0 )
+        return ( errno == ENOENT ) ? NOERR : errno;                             // a new master
+    result = _read_manifest(m, f);
+    fclose(f);
+    debug("%s : %zu segments\n", path, m->count);
+
+    if( result )
+        master_close(m);
+    return result;
+    }
+
+
+/*  function        void master_close( master * m )
+
+    brief           Frees the list of segments.
+
+    param[in/out]   master * m, the master history
+*/
+void master_close( master * m )
+    {
+    free(m->segments);
+    m->segments = 0;
+    m->count = 0;
+    m->capacity = 0;
+    }
+
+
+/*  function        int master_segment_path( const master * m, size_t s, char * path, size_t len )
+
+    brief           Gives the path of a segment.
+
+    param[in]       const master * m, the master history
+    param[in]       size_t s, the segment's index
+    param[out]      char * path, the segment's path
+    param[in]       size_t len, size of path
+
+    return          int, error code
+*/
+int master_segment_path( const master * m, size_t s, char * path, size_t len )
+    {
+    if( (size_t)snprintf(path, len, "%s/%s", m->path, m->segments[s].name) >= len )
+        return ERR_FILE_NAME_LENGTH;
+
+    return NOERR;
+    }
+
+
+/*  function        static int _add_known( const master * m, record_set * set, long long from, long long to )
+
+    brief           Adds the records of all segments from time <from> to
+                    time <to> to the set. Only the blocks of the segments
+                    overlapping the time range are read.
+
+    param[in]       const master * m, the master history
+    param[in/out]   record_set * set, the records known
+    param[in]       long long from, time key of the first new record
+    param[in]       long long to, time key of the last new record
+
+    return          int, error code
+*/
+static int _add_known( const master * m, record_set * set, long long from, long long to )
+    {
+    char name[MASTER_PATH_LEN];
+    gtx g;
+    gtx_block block;
+    dataset data;
+    size_t s;
+    size_t b;
+    size_t i;
+    int added;
+    int result = NOERR;
+
+    for( s = 0; ( s < m->count ) && ( result == NOERR ); ++s )
+        {
+        if( ( m->segments[s].max_time < from ) || ( m->segments[s].min_time > to ) )
+            continue;                                                           // no overlap
+        result = master_segment_path(m, s, name, MASTER_PATH_LEN);
+        if( result == NOERR )
+            result = gtx_open(&g, name);
+        if( result )
+            break;
+        gtx_find(&g, from, &b, &i);
+        for( ; ( b < g.header->blocks ) && ( g.blocks[b].min_time <= to ) && ( result == NOERR ); ++b, i = 0 )
+            {
+            gtx_get_block(&g, b, &block);
+            for( ; ( i < block.count ) && ( block.base + block.time[i] <= to ) && ( result == NOERR ); ++i )
+                {
+                gtx_get(&g, &block, i, &data);
+                result = record_set_add(set, &data, &added);
+                }
+            }
+        gtx_close(&g);
+        debug("%s : %zu known records\n", name, set->count);
+        }
+
+    return result;
+    }
+
+
+/*  function        static int _sync( const char * name )
+
+    brief           Writes a file or a directory through to the disk.
+
+    param[in]       const char * name, name of the file or directory
+
+    return          int, error code
+*/
+static int _sync( const char * name )
+    {
+    int fd = open(name, O_RDONLY);
+    int result = NOERR;
+
+    if( fd < 0 )
+        return errno;
+    if( fsync(fd) != 0 )
+        result = errno;
+    close(fd);
+
+    return result;
+    }
+
+
+/*  function        static int _write_segment( master * m, const dataset * data, size_t records, const unsigned char * fresh, master_segment * segment )
+
+    brief           Writes the new records to a new segment, first under a
+                    temporary name, then renamed. The segment and then the
+                    directory are on the disk before it is returned, so the
+                    manifest never names a segment that may be lost.
+
+    param[in]       master * m, the master history
+    param[in]       const dataset * data, the records sorted by time
+    param[in]       size_t records, number of records
+    param[in]       const unsigned char * fresh, TRUE for the records to write
+    param[out]      master_segment * segment, the segment written
+
+    return          int, error code
+*/
+static int _write_segment( master * m, const dataset * data, size_t records, const unsigned char * fresh,
+    master_segment * segment )
+    {
+    char name[MASTER_PATH_LEN];
+    char temporary[MASTER_PATH_LEN];
+    gtx_writer w;
+    size_t i;
+    int result;
+
+    memset(segment, 0, sizeof(master_segment));
+    snprintf(segment->name, MASTER_SEGMENT_LEN, "segment-%06zu.gtx", m->count + 1);
+    if( ( (size_t)snprintf(name, MASTER_PATH_LEN, "%s/%s", m->path, segment->name) >= MASTER_PATH_LEN )
+        || ( (size_t)snprintf(temporary, MASTER_PATH_LEN, "%s.new", name) >= MASTER_PATH_LEN ) )
+        return ERR_FILE_NAME_LENGTH;
+
+    result = gtx_create(&w, temporary);
+    if( result )
+        return result;
+    for( i = 0; ( i < records ) && ( result == NOERR ); ++i )
+        {
+        if( !fresh[i] )
+            continue;
+        if( segment->records++ == 0 )
+            segment->min_time = data[i].time_key;
+        segment->max_time = data[i].time_key;
+        result = gtx_write(&w, data + i);
+        }
+    result = gtx_finish(&w, result);
+    if( result == NOERR )
+        result = _sync(temporary);
+    if( ( result == NOERR ) && ( rename(temporary, name) != 0 ) )
+        result = errno;
+    if( result )
+        unlink(temporary);
+    else
+        result = _sync(m->path);                                                // the rename is on the disk
+
+    return result;
+    }
+
+
+/*  function        int master_append( master * m, const dataset * data, size_t records, size_t * added )
+
+    brief           Appends the records not in the master yet as a new
+                    segment. The records have to be sorted by time and free
+                    of duplicates, as merged by mixfiles.
+
+    param[in/out]   master * m, the master history
+    param[in]       const dataset * data, the records
+    param[in]       size_t records, number of records
+    param[out]      size_t * added, number of records appended
+
+    return          int, error code
+*/
+int master_append( master * m, const dataset * data, size_t records, size_t * added )
+    {
+    char name[MASTER_PATH_LEN];
+    master_segment segment;
+    record_set known;
+    unsigned char * fresh;
+    FILE * f;
+    size_t i;
+    int is_new;
+    int n;
+    int result;
+
+    *added = 0;
+    if( records == 0 )
+        return NOERR;
+
+    fresh = (unsigned char *)malloc(records);
+    if( fresh == 0 )
+        return ERR_NOT_ENOUGH_MEMORY;
+    result = record_set_init(&known, 0);
+    if( result == NOERR )
+        result = _add_known(m, &known, data[0].time_key, data[records - 1].time_key);
+    for( i = 0; ( i < records ) && ( result == NOERR ); ++i )
+        {
+        result = record_set_add(&known, data + i, &is_new);
+        fresh[i] = (unsigned char)is_new;
+        *added += (size_t)is_new;
+        }
+    record_set_free(&known);
+    debug("%zu of %zu records are new\n", *added, records);
+
+    if( ( result == NOERR ) && *added )
+        result = _write_segment(m, data, records, fresh, &segment);
+    free(fresh);
+    if( result || ( *added == 0 ) )
+        return result;
+
+    if( (size_t)snprintf(name, MASTER_PATH_LEN, "%s/%s", m->path, MASTER_MANIFEST) >= MASTER_PATH_LEN )
+        return ERR_FILE_NAME_LENGTH;
+    if( ( truncate(name, m->length) != 0 ) && ( errno != ENOENT ) )             // drop a line cut short
+        return errno;
+    f = fopen(name, "a");
+    if( f == 0 )
+        return errno;
+    n = fprintf(f, "%s %zu %lld %lld\n", segment.name, segment.records, segment.min_time, segment.max_time);
+    if( n < 0 )
+        result = ERR_WRITE_TO_FILE;
+    if( ( fflush(f) != 0 ) || ( fsync(fileno(f)) != 0 ) )                      // the segment is part of the master now
+        result = ERR_WRITE_TO_FILE;
+    fclose(f);
+    if( result == NOERR )
+        {
+        m->length += n;
+        result = _add_segment(m, &segment);
+        }
+
+    return result;
+    }
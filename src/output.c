@@ -0,0 +1,316 @@
+/*
+    Copyright (C)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+    See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.
+    If not, see <http://www.gnu.org/licenses/>.
+
+    Klabautermann Software
+    Uwe Jantzen
+    Weingartener Straße 33
+    76297 Stutensee
+    Germany
+
+    file        output.c
+
+    date        19.10.2026
+
+    author      Uwe Jantzen (jantzen@klabautermann-software.de)
+
+    brief       Buffered output written by a background thread
+
+    details     Records are collected in large buffers. Full buffers are
+                handed over to a writer thread through a ring and written
+                with one write() call each, so the producer never waits for
+                the disk.
+                A replaced file is written to a temporary file in the same
+                directory which is synced and renamed to the final name when
+                the output is closed. So after a crash there is either the
+                old or the complete new file, never a partial one.
+                A file named *.gz or *.zst is compressed by the writer
+                thread, appending adds a new gzip member / zstd frame.
+
+    project     glucotux
+    target      Linux
+    begin       03.03.2012
+
+    note
+
+    todo
+
+*/
+
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <assert.h>
+#include "errors.h"
+#include "globals.h"
+#include "debug.h"
+#include "ring.h"
+#include "cfile.h"
+#include "output.h"
+
+
+#define OUTPUT_BUFFERS                      4
+#define OUTPUT_BUFFER_LEN                   (64 * 1024)
+
+
+/*  function        static void * _writer_thread( void * arg )
+
+    brief           Writer thread : writes the buffers put into the ring until
+                    the output is closed and the ring is empty.
+                    After an error the remaining buffers are dropped.
+
+    param[in]       void * arg, the output
+
+    return          void *, unused
+*/
+static void * _writer_thread( void * arg )
+    {
+    output * out = (output *)arg;
+    char * buffer;
+    size_t length;
+    ssize_t n;
+
+    while( ( buffer = ring_wait_read(&out->buffers, &length) ) != 0 )
+        {
+        if( ( out->file != 0 ) && length && ( atomic_load(&out->result) == NOERR ) )
+            {
+            if( fwrite(buffer, 1, length, out->file) != length )
+                atomic_store(&out->result, ERR_WRITE_TO_FILE);
+            length = 0;
+            }
+        while( length && ( atomic_load(&out->result) == NOERR ) )
+            {
+            n = write(out->fd, buffer, length);
+            if( n < 0 )
+                {
+                if( errno == EINTR )
+                    continue;
+                showerr(errno);
+                atomic_store(&out->result, ERR_WRITE_TO_FILE);
+                break;
+                }
+            buffer += n;
+            length -= (size_t)n;
+            }
+        ring_release(&out->buffers);
+        }
+
+    return 0;
+    }
+
+
+/*  function        int output_open( output * out, const char * filename, int mode )
+
+    brief           Opens an output and starts its writer thread.
+                    If no file name is given the output goes to stdout.
+
+    param[out]      output * out, the output
+    param[in]       const char * filename, name of the file to write to
+    param[in]       int mode, OUTPUT_REPLACE, OUTPUT_APPEND or OUTPUT_DIRECT
+
+    return          int, error code
+*/
+int output_open( output * out, const char * filename, int mode )
+    {
+    mode_t mask;
+    int result;
+    assert(out);
+
+    memset(out, 0, sizeof(output));
+    out->fd = -1;
+    out->mode = mode;
+
+    if( ( filename == 0 ) || ( *filename == 0 ) )
+        {
+        out->fd = STDOUT_FILENO;
+        out->mode = OUTPUT_DIRECT;
+        }
+    else
+        {
+        if( strlen(filename) > OUTPUT_NAME_LEN - 8 )
+            return ERR_FILE_NAME_LENGTH;
+        strcpy(out->name, filename);
+        switch( mode )
+            {
+            case OUTPUT_REPLACE:
+                snprintf(out->temp_name, OUTPUT_NAME_LEN, "%s.XXXXXX", filename);
+                out->fd = mkstemp(out->temp_name);
+                if( out->fd >= 0 )
+                    {
+                    mask = umask(0);                                            // same permissions as a file made by fopen()
+                    umask(mask);
+                    fchmod(out->fd, 0666 & ~mask);
+                    }
+                break;
+            case OUTPUT_APPEND:
+                out->fd = open(filename, O_WRONLY | O_CREAT | O_APPEND, 0666);
+                break;
+            default:
+                out->fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+                break;
+            }
+        if( ( out->fd >= 0 ) && ( cfile_kind_of_name(filename) != CFILE_PLAIN ) )
+            {
+            out->file = cfdopen(dup(out->fd), "w", cfile_kind_of_name(filename));  // the stream's fd is closed first, then fd is synced
+            if( out->file == 0 )
+                {
+                showerr(errno);
+                close(out->fd);
+                if( mode == OUTPUT_REPLACE )
+                    unlink(out->temp_name);
+                return ERR_OPEN_LOG_FILE;
+                }
+            }
+        if( out->fd < 0 )
+            {
+            showerr(errno);
+            return ERR_OPEN_LOG_FILE;
+            }
+        }
+    debug("Output %s (%s) mode %d\n", out->name, out->temp_name, out->mode);
+
+    result = ring_init(&out->buffers, OUTPUT_BUFFERS, OUTPUT_BUFFER_LEN);
+    if( result == NOERR )
+        {
+        atomic_init(&out->result, NOERR);
+        if( pthread_create(&out->thread, 0, _writer_thread, out) )
+            {
+            ring_free(&out->buffers);
+            result = ERR_START_THREAD;
+            }
+        }
+    if( result )
+        {
+        if( out->file != 0 )
+            fclose(out->file);
+        out->file = 0;
+        if( out->fd != STDOUT_FILENO )
+            close(out->fd);
+        if( out->mode == OUTPUT_REPLACE )
+            unlink(out->temp_name);
+        out->fd = -1;
+        }
+
+    return result;
+    }
+
+
+/*  function        int output_write( output * out, const char * data, size_t length )
+
+    brief           Copies data into the output's buffers. Full buffers are
+                    handed over to the writer thread.
+
+    param[in]       output * out, the output
+    param[in]       const char * data, data to write
+    param[in]       size_t length, number of bytes to write
+
+    return          int, error code of the writer thread
+*/
+int output_write( output * out, const char * data, size_t length )
+    {
+    size_t n;
+
+    while( length )
+        {
+        if( out->buffer == 0 )
+            {
+            out->buffer = ring_wait_write(&out->buffers);
+            out->fill = 0;
+            }
+        n = OUTPUT_BUFFER_LEN - out->fill;
+        if( n > length )
+            n = length;
+        memcpy(out->buffer + out->fill, data, n);
+        out->fill += n;
+        data += n;
+        length -= n;
+        if( out->fill == OUTPUT_BUFFER_LEN )
+            {
+            ring_put(&out->buffers, out->fill);
+            out->buffer = 0;
+            }
+        }
+
+    return atomic_load(&out->result);
+    }
+
+
+/*  function        int output_close( output * out, int commit )
+
+    brief           Writes the remaining data, stops the writer thread and
+                    closes the output.
+                    A replaced file is synced and renamed to its final name if
+                    <commit> is set, else it is removed and the old file is
+                    kept. Appended data is synced.
+
+    param[in]       output * out, the output
+    param[in]       int commit, FALSE to throw away a replaced file
+
+    return          int, error code
+*/
+int output_close( output * out, int commit )
+    {
+    int result;
+
+    if( out->fd < 0 )
+        return NOERR;
+
+    if( out->buffer != 0 )
+        {
+        if( out->fill )
+            ring_put(&out->buffers, out->fill);
+        out->buffer = 0;
+        }
+    ring_close(&out->buffers);
+    pthread_join(out->thread, 0);
+    ring_free(&out->buffers);
+    result = atomic_load(&out->result);
+
+    if( out->file != 0 )                                                        // finish the compressed stream
+        {
+        if( fclose(out->file) && ( result == NOERR ) )
+            result = ERR_WRITE_TO_FILE;
+        out->file = 0;
+        }
+    if( out->fd != STDOUT_FILENO )
+        {
+        if( ( result == NOERR ) && ( out->mode != OUTPUT_DIRECT ) && fsync(out->fd) )
+            result = ERR_WRITE_TO_FILE;
+        if( close(out->fd) && ( result == NOERR ) )
+            result = ERR_WRITE_TO_FILE;
+        }
+    out->fd = -1;
+
+    if( out->mode == OUTPUT_REPLACE )
+        {
+        if( commit && ( result == NOERR ) )
+            {
+            if( rename(out->temp_name, out->name) )
+                {
+                showerr(errno);
+                result = ERR_WRITE_TO_FILE;
+                }
+            }
+        else
+            unlink(out->temp_name);
+        }
+
+    return result;
+    }
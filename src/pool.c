@@ -0,0 +1,150 @@
+/*
+    Copyright (C)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+    See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.
+    If not, see <http://www.gnu.org/licenses/>.
+
+    Klabautermann Software
+    Uwe Jantzen
+    Weingartener Straße 33
+    76297 Stutensee
+    Germany
+
+    file        pool.c
+
+    date        19.10.2026
+
+    author      Uwe Jantzen (jantzen@klabautermann-software.de)
+
+    brief       Runs jobs on worker threads
+
+    details     The jobs are numbered, every worker takes the next number until
+                all are done. The calling thread is one of the workers.
+                A job that runs a pool itself does its jobs in its own thread,
+                so the threads are never multiplied.
+
+    project     glucotux
+    target      Linux
+    begin       03.03.2012
+
+    note
+
+    todo
+
+*/
+
+
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "debug.h"
+#include "globals.h"
+#include "pool.h"
+
+
+#define MAX_THREADS                         64
+
+
+typedef struct pool_t
+    {
+    int jobs;
+    pool_job work;
+    void * arg;
+    atomic_int next;                                                            // number of the next job to take
+    } pool;
+
+
+static _Thread_local int in_pool = 0;                                           // the thread is doing a job of a pool
+
+
+/*  function        static void * _worker_thread( void * arg )
+
+    brief           Does jobs until there are no more.
+
+    param[in]       void * arg, the pool
+
+    return          void *, nothing
+*/
+static void * _worker_thread( void * arg )
+    {
+    pool * p = (pool *)arg;
+    int job;
+    int nested = in_pool;
+
+    in_pool = 1;
+    while( ( job = atomic_fetch_add(&p->next, 1) ) < p->jobs )
+        p->work(p->arg, job);
+    in_pool = nested;
+
+    return 0;
+    }
+
+
+/*  function        int pool_threads( void )
+
+    brief           Returns the number of threads jobs are run on, set by -t
+                    or the number of processors.
+
+    return          int, number of threads
+*/
+int pool_threads( void )
+    {
+    long threads = get_threads();
+
+    if( threads <= 0 )
+        threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if( threads < 1 )
+        threads = 1;
+    if( threads > MAX_THREADS )
+        threads = MAX_THREADS;
+
+    return (int)threads;
+    }
+
+
+/*  function        void pool_run( int jobs, pool_job work, void * arg )
+
+    brief           Runs work(arg, 0) ... work(arg, jobs - 1) on the threads
+                    and returns when all are done. If threads can't be
+                    started the jobs are done by the others. Called by a
+                    job of a pool, all jobs are done by the calling thread.
+
+    param[in]       int jobs, number of jobs
+    param[in]       pool_job work, does one job
+    param[in]       void * arg, passed to work
+*/
+void pool_run( int jobs, pool_job work, void * arg )
+    {
+    pthread_t threads[MAX_THREADS];
+    int started = 0;
+    int wanted = pool_threads();
+    pool p;
+
+    p.jobs = jobs;
+    p.work = work;
+    p.arg = arg;
+    atomic_init(&p.next, 0);
+
+    if( in_pool )
+        wanted = 1;                                                             // no pool in a pool
+    if( wanted > jobs )
+        wanted = jobs;
+    while( ( started < wanted - 1 ) && ( pthread_create(threads + started, 0, _worker_thread, &p) == 0 ) )
+        ++started;
+    debug("%d jobs on %d threads\n", jobs, started + 1);
+    _worker_thread(&p);
+
+    while( started > 0 )
+        pthread_join(threads[--started], 0);
+    }
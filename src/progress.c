@@ -0,0 +1,267 @@
+/*
+    Copyright (C)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+    See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.
+    If not, see <http://www.gnu.org/licenses/>.
+
+    Klabautermann Software
+    Uwe Jantzen
+    Weingartener Straße 33
+    76297 Stutensee
+    Germany
+
+    file        progress.c
+
+    date        19.10.2026
+
+    author      Uwe Jantzen (jantzen@klabautermann-software.de)
+
+    brief       Progress, throughput and ETA of a transfer
+
+    details     Counts the records done and the bytes read, the number of
+                records expected is taken from the header record.
+                From this records/s, bytes/s and the estimated time left are
+                calculated. The progress is shown on the terminal and/or
+                written as JSON lines to a file descriptor (option -p), one
+                object per update :
+                {"state":"transfer","records":120,"expected":1316,
+                 "records_per_s":41.5,"bytes":9152,"bytes_per_s":3165.2,
+                 "elapsed_s":2.9,"eta_s":28.8}
+                state is one of "waiting", "transfer", "done" or "error".
+                Updates are limited to a fixed refresh rate.
+                While the application waits for the meter the time waited
+                is shown.
+                A progress pipe closed by the reader does not stop the
+                transfer, SIGPIPE is held back while writing to it and the
+                progress stream is given up.
+                Bytes are counted by the reader thread, everything else is
+                done by the decoder thread.
+
+    project     glucotux
+    target      Linux
+    begin       03.03.2012
+
+    note
+
+    todo
+
+*/
+
+
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <signal.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "errors.h"
+#include "globals.h"
+#include "utils.h"
+#include "progress.h"
+
+
+#define PROGRESS_INTERVAL                   0.1                                 // seconds between two updates
+#define PROGRESS_LINE_LEN                   256
+
+
+static int show_on_terminal = FALSE;
+static int waiting = FALSE;                                                     // start_time is the start of waiting
+static struct timespec start_time;
+static struct timespec update_time;                                             // last update
+static int records = 0;
+static int expected = 0;                                                        // 0 if unknown
+static atomic_size_t bytes = 0;
+
+
+/*  function        static void _write( int fd, const char * line, size_t len )
+
+    brief           Writes a progress line. SIGPIPE is blocked while writing,
+                    a pipe closed by the reader only stops the progress
+                    stream, not the application.
+
+    param[in]       int fd, progress file descriptor
+    param[in]       const char * line, the line
+    param[in]       size_t len, length of the line
+*/
+static void _write( int fd, const char * line, size_t len )
+    {
+    sigset_t pipe_signal;
+    sigset_t old;
+    struct timespec no_wait = { 0, 0 };
+    ssize_t n;
+
+    sigemptyset(&pipe_signal);
+    sigaddset(&pipe_signal, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipe_signal, &old);
+    n = write(fd, line, len);
+    if( ( n < 0 ) && ( errno == EPIPE ) )
+        sigtimedwait(&pipe_signal, 0, &no_wait);                                // drop the signal raised by the write
+    pthread_sigmask(SIG_SETMASK, &old, 0);
+    if( n < 0 )
+        set_progress_fd(-1);                                                    // nobody listens any more
+    }
+
+
+/*  function        static void _update( const char * state, int force )
+
+    brief           Shows the current progress if the last update is at least
+                    PROGRESS_INTERVAL seconds ago or if forced.
+
+    param[in]       const char * state, "waiting", "transfer", "done" or "error"
+    param[in]       int force, TRUE : update now
+*/
+static void _update( const char * state, int force )
+    {
+    char line[PROGRESS_LINE_LEN];
+    double elapsed;
+    double records_per_s = 0.0;
+    double bytes_per_s = 0.0;
+    double eta = -1.0;                                                          // unknown
+    size_t bytes_read = atomic_load(&bytes);
+    int fd = get_progress_fd();
+    int len;
+
+    if( !show_on_terminal && ( fd < 0 ) )
+        return;
+    if( !force && ( seconds_since(&update_time) < PROGRESS_INTERVAL ) )
+        return;
+    clock_gettime(CLOCK_MONOTONIC, &update_time);
+
+    elapsed = seconds_since(&start_time);
+    if( elapsed > 0.0 )
+        {
+        records_per_s = (double)records / elapsed;
+        bytes_per_s = (double)bytes_read / elapsed;
+        }
+    if( ( expected > records ) && ( records_per_s > 0.0 ) )
+        eta = (double)(expected - records) / records_per_s;
+    else if( expected && ( records >= expected ) )
+        eta = 0.0;
+
+    if( show_on_terminal && waiting )
+        {
+        printf("%cWaiting for the meter %5.1f s ", CR, elapsed);
+        fflush(stdout);
+        }
+    else if( show_on_terminal )
+        {
+        if( eta >= 0.0 )
+            printf("%c%4d / %4d records  %6.1f records/s  %8.0f bytes/s  ETA %d:%02d ",
+                CR, records, expected, records_per_s, bytes_per_s, (int)eta / 60, (int)eta % 60);
+        else
+            printf("%c%4d records  %6.1f records/s  %8.0f bytes/s ", CR, records, records_per_s, bytes_per_s);
+        fflush(stdout);
+        }
+
+    if( fd >= 0 )
+        {
+        len = snprintf(line, PROGRESS_LINE_LEN,
+            "{\"state\":\"%s\",\"records\":%d,\"expected\":%d,\"records_per_s\":%.1f,"
+            "\"bytes\":%lu,\"bytes_per_s\":%.1f,\"elapsed_s\":%.1f,\"eta_s\":%.1f}\n",
+            state, records, expected, records_per_s, bytes_read, bytes_per_s, elapsed, eta);
+        if( ( len > 0 ) && ( len < PROGRESS_LINE_LEN ) )
+            _write(fd, line, (size_t)len);
+        }
+    }
+
+
+/*  function        void progress_start( int terminal )
+
+    brief           Starts counting for a new transfer.
+
+    param[in]       int terminal, TRUE : show the progress on the terminal
+*/
+void progress_start( int terminal )
+    {
+    show_on_terminal = terminal;
+    waiting = FALSE;
+    records = 0;
+    expected = 0;
+    atomic_store(&bytes, 0);
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+    update_time = start_time;
+    }
+
+
+/*  function        void progress_set_expected( int n )
+
+    brief           Sets the number of records the meter announced.
+
+    param[in]       int n, number of records expected
+*/
+void progress_set_expected( int n )
+    {
+    expected = ( n > 0 ) ? n : 0;
+    }
+
+
+/*  function        void progress_add_bytes( size_t n )
+
+    brief           Counts bytes read from the meter.
+                    Called by the reader thread.
+
+    param[in]       size_t n, number of bytes read
+*/
+void progress_add_bytes( size_t n )
+    {
+    atomic_fetch_add(&bytes, n);
+    }
+
+
+/*  function        void progress_add_record( void )
+
+    brief           Counts a record done and updates the progress.
+*/
+void progress_add_record( void )
+    {
+    ++records;
+    _update("transfer", FALSE);
+    }
+
+
+/*  function        void progress_finish( int result )
+
+    brief           Shows the final progress of a transfer.
+
+    param[in]       int result, the transfer's error code
+*/
+void progress_finish( int result )
+    {
+    _update(( result == NOERR ) ? "done" : "error", TRUE);
+    }
+
+
+/*  function        void progress_wait( void )
+
+    brief           Shows that the application is waiting for the meter :
+                    the time waited on the terminal, state "waiting" on the
+                    progress stream.
+*/
+void progress_wait( void )
+    {
+    if( !waiting )
+        {
+        waiting = TRUE;
+        show_on_terminal = !is_verbose();
+        records = 0;
+        expected = 0;
+        atomic_store(&bytes, 0);
+        clock_gettime(CLOCK_MONOTONIC, &start_time);
+        update_time = start_time;
+        _update("waiting", TRUE);
+        }
+    else
+        _update("waiting", FALSE);
+    }
@@ -0,0 +1,280 @@
+/*
+    Copyright (C)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+    See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.
+    If not, see <http://www.gnu.org/licenses/>.
+
+    Klabautermann Software
+    Uwe Jantzen
+    Weingartener Straße 33
+    76297 Stutensee
+    Germany
+
+    file        ring.c
+
+    date        19.10.2026
+
+    author      Uwe Jantzen (jantzen@klabautermann-software.de)
+
+    brief       Single-producer / single-consumer ring of buffers
+
+    details     A lock-free ring that hands over buffers from one thread
+                to another. The producer gets a free buffer, fills it and
+                puts it; the consumer gets the oldest filled buffer, uses it
+                and releases it. The buffers are never copied.
+                head and tail are free running counters, the slot is the
+                counter modulo the number of slots. Each counter is written by
+                one thread only, so a release store after the buffer was
+                filled (or used) and an acquire load before the buffer is
+                accessed are all the synchronisation needed.
+                A thread that has to wait for a buffer, or for the consumer
+                to catch up, blocks on a condition variable. Every put and
+                release signals it, so a waiting thread wakes up at once.
+
+    project     glucotux
+    target      Linux
+    begin       03.03.2012
+
+    note
+
+    todo
+
+*/
+
+
+#include <stdlib.h>
+#include <assert.h>
+#include "errors.h"
+#include "ring.h"
+
+
+/*  function        int ring_init( ring * r, size_t slots, size_t slot_size )
+
+    brief           Allocates the buffers of a ring.
+
+    param[out]      ring * r, the ring
+    param[in]       size_t slots, number of buffers, must be a power of 2
+    param[in]       size_t slot_size, size of every buffer
+
+    return          int, error code
+*/
+int ring_init( ring * r, size_t slots, size_t slot_size )
+    {
+    assert(r);
+    assert(slots && !(slots & (slots - 1)));
+
+    r->slots = slots;
+    r->slot_size = slot_size;
+    r->buffers = (char *)malloc(slots * slot_size);
+    r->lengths = (size_t *)calloc(slots, sizeof(size_t));
+    atomic_init(&r->head, 0);
+    atomic_init(&r->tail, 0);
+    r->closed = 0;
+    pthread_mutex_init(&r->lock, 0);
+    pthread_cond_init(&r->changed, 0);
+    if( ( r->buffers == 0 ) || ( r->lengths == 0 ) )
+        {
+        ring_free(r);
+        return ERR_NOT_ENOUGH_MEMORY;
+        }
+
+    return NOERR;
+    }
+
+
+/*  function        void ring_free( ring * r )
+
+    brief           Frees the buffers of a ring.
+
+    param[in]       ring * r, the ring
+*/
+void ring_free( ring * r )
+    {
+    free(r->buffers);
+    free(r->lengths);
+    r->buffers = 0;
+    r->lengths = 0;
+    pthread_cond_destroy(&r->changed);
+    pthread_mutex_destroy(&r->lock);
+    }
+
+
+/*  function        static void _signal( ring * r )
+
+    brief           Wakes up a thread waiting for the ring.
+
+    param[in]       ring * r, the ring
+*/
+static void _signal( ring * r )
+    {
+    pthread_mutex_lock(&r->lock);
+    pthread_cond_broadcast(&r->changed);
+    pthread_mutex_unlock(&r->lock);
+    }
+
+
+/*  function        char * ring_get_write( ring * r )
+
+    brief           Producer : returns the next free buffer.
+
+    param[in]       ring * r, the ring
+
+    return          char *, free buffer, 0 if the ring is full
+*/
+char * ring_get_write( ring * r )
+    {
+    size_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+
+    if( head - atomic_load_explicit(&r->tail, memory_order_acquire) == r->slots )
+        return 0;
+
+    return r->buffers + (head & (r->slots - 1)) * r->slot_size;
+    }
+
+
+/*  function        void ring_put( ring * r, size_t length )
+
+    brief           Producer : hands over the buffer returned by
+                    ring_get_write() to the consumer.
+
+    param[in]       ring * r, the ring
+    param[in]       size_t length, number of bytes used in the buffer
+*/
+void ring_put( ring * r, size_t length )
+    {
+    size_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+
+    r->lengths[head & (r->slots - 1)] = length;
+    atomic_store_explicit(&r->head, head + 1, memory_order_release);
+    _signal(r);
+    }
+
+
+/*  function        char * ring_get_read( ring * r, size_t * length )
+
+    brief           Consumer : returns the oldest filled buffer.
+
+    param[in]       ring * r, the ring
+    param[out]      size_t * length, number of bytes used in the buffer
+
+    return          char *, filled buffer, 0 if the ring is empty
+*/
+char * ring_get_read( ring * r, size_t * length )
+    {
+    size_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    size_t slot;
+
+    if( tail == atomic_load_explicit(&r->head, memory_order_acquire) )
+        return 0;
+
+    slot = tail & (r->slots - 1);
+    *length = r->lengths[slot];
+
+    return r->buffers + slot * r->slot_size;
+    }
+
+
+/*  function        void ring_release( ring * r )
+
+    brief           Consumer : gives back the buffer returned by
+                    ring_get_read() to the producer.
+
+    param[in]       ring * r, the ring
+*/
+void ring_release( ring * r )
+    {
+    size_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+
+    atomic_store_explicit(&r->tail, tail + 1, memory_order_release);
+    _signal(r);
+    }
+
+
+/*  function        void ring_close( ring * r )
+
+    brief           Producer : no more buffers will be put. A consumer
+                    waiting in ring_wait_read() gets the buffers left, then 0.
+
+    param[in]       ring * r, the ring
+*/
+void ring_close( ring * r )
+    {
+    pthread_mutex_lock(&r->lock);
+    r->closed = 1;
+    pthread_cond_broadcast(&r->changed);
+    pthread_mutex_unlock(&r->lock);
+    }
+
+
+/*  function        char * ring_wait_write( ring * r )
+
+    brief           Producer : returns the next free buffer, waits until the
+                    consumer releases one if the ring is full.
+
+    param[in]       ring * r, the ring
+
+    return          char *, free buffer
+*/
+char * ring_wait_write( ring * r )
+    {
+    char * buffer;
+
+    pthread_mutex_lock(&r->lock);
+    while( ( buffer = ring_get_write(r) ) == 0 )
+        pthread_cond_wait(&r->changed, &r->lock);
+    pthread_mutex_unlock(&r->lock);
+
+    return buffer;
+    }
+
+
+/*  function        char * ring_wait_read( ring * r, size_t * length )
+
+    brief           Consumer : returns the oldest filled buffer, waits until
+                    the producer puts one if the ring is empty.
+
+    param[in]       ring * r, the ring
+    param[out]      size_t * length, number of bytes used in the buffer
+
+    return          char *, filled buffer, 0 if the ring is empty and closed
+*/
+char * ring_wait_read( ring * r, size_t * length )
+    {
+    char * buffer;
+
+    pthread_mutex_lock(&r->lock);
+    while( ( ( buffer = ring_get_read(r, length) ) == 0 ) && !r->closed )
+        pthread_cond_wait(&r->changed, &r->lock);
+    pthread_mutex_unlock(&r->lock);
+
+    return buffer;
+    }
+
+
+/*  function        void ring_wait_empty( ring * r )
+
+    brief           Producer : waits until the consumer has released all
+                    buffers put.
+
+    param[in]       ring * r, the ring
+*/
+void ring_wait_empty( ring * r )
+    {
+    pthread_mutex_lock(&r->lock);
+    while( atomic_load_explicit(&r->tail, memory_order_acquire)
+        != atomic_load_explicit(&r->head, memory_order_relaxed) )
+        pthread_cond_wait(&r->changed, &r->lock);
+    pthread_mutex_unlock(&r->lock);
+    }
+
@@ -0,0 +1,241 @@
+/*
+    Copyright (C)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+    See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.
+    If not, see <http://www.gnu.org/licenses/>.
+
+    Klabautermann Software
+    Uwe Jantzen
+    Weingartener Straße 33
+    76297 Stutensee
+    Germany
+
+    file        store.c
+
+    date        19.10.2026
+
+    author      Uwe Jantzen (jantzen@klabautermann-software.de)
+
+    brief       SQLite record store
+
+    details     Records are kept in one table of an SQLite database :
+                    records(meter, timestamp, type, value, unit, flags,
+                            record_number)
+                timestamp is YYYYMMDDhhmmss as a number. A record is unique
+                by (meter, timestamp, type, value), storing it again is
+                ignored, so downloads and files may overlap. Indexes on
+                timestamp and type serve range queries.
+                Inserts use one prepared statement and are committed in
+                batches of STORE_BATCH records.
+                Only built if HAVE_SQLITE is defined (make sqlite=1),
+                otherwise store_open() reports ERR_NO_SQLITE.
+
+    project     glucotux
+    target      Linux
+    begin       03.03.2012
+
+    note
+
+    todo
+
+*/
+
+
+#include <string.h>
+#ifdef HAVE_SQLITE
+#include <sqlite3.h>
+#endif  // HAVE_SQLITE
+#include "errors.h"
+#include "debug.h"
+#include "store.h"
+
+
+#define STORE_BATCH                         1000                                // records per transaction
+
+
+#ifdef HAVE_SQLITE
+
+static const char schema[] =
+    "PRAGMA journal_mode = WAL;"
+    "PRAGMA synchronous = NORMAL;"
+    "CREATE TABLE IF NOT EXISTS records ("
+        "meter TEXT NOT NULL,"
+        "timestamp INTEGER NOT NULL,"
+        "type TEXT NOT NULL,"
+        "value INTEGER NOT NULL,"
+        "unit TEXT NOT NULL,"
+        "flags TEXT NOT NULL,"
+        "record_number INTEGER NOT NULL,"
+        "UNIQUE (meter, timestamp, type, value));"
+    "CREATE INDEX IF NOT EXISTS records_timestamp ON records (timestamp);"
+    "CREATE INDEX IF NOT EXISTS records_type ON records (type);";
+
+static const char insert_record[] =
+    "INSERT OR IGNORE INTO records (meter, timestamp, type, value, unit, flags, record_number) "
+    "VALUES (?, ?, ?, ?, ?, ?, ?);";
+
+
+/*  function        static int _exec( store * st, const char * sql )
+
+    brief           Executes SQL statements without results.
+
+    param[in]       store * st, the store
+    param[in]       const char * sql, the statements
+
+    return          int, error code
+*/
+static int _exec( store * st, const char * sql )
+    {
+    char * message = 0;
+
+    if( sqlite3_exec(st->db, sql, 0, 0, &message) != SQLITE_OK )
+        {
+        debug("SQLite : %s\n", message ? message : "?");
+        sqlite3_free(message);
+        return ERR_STORE;
+        }
+
+    return NOERR;
+    }
+
+
+#endif  // HAVE_SQLITE
+
+
+/*  function        int store_open( store * st, const char * name )
+
+    brief           Opens the store, creates its table and indexes if the
+                    database is new and starts the first transaction.
+
+    param[out]      store * st, the store
+    param[in]       const char * name, file name of the database
+
+    return          int, error code
+*/
+int store_open( store * st, const char * name )
+    {
+    memset(st, 0, sizeof(store));
+#ifdef HAVE_SQLITE
+    if( sqlite3_open(name, &st->db) != SQLITE_OK )
+        {
+        debug("SQLite : %s\n", sqlite3_errmsg(st->db));
+        sqlite3_close(st->db);
+        st->db = 0;
+        return ERR_STORE;
+        }
+    if( ( _exec(st, schema) != NOERR )
+            || ( sqlite3_prepare_v2(st->db, insert_record, -1, &st->insert, 0) != SQLITE_OK )
+            || ( _exec(st, "BEGIN;") != NOERR ) )
+        {
+        sqlite3_finalize(st->insert);
+        sqlite3_close(st->db);
+        st->db = 0;
+        return ERR_STORE;
+        }
+
+    return NOERR;
+#else
+    (void)name;
+    return ERR_NO_SQLITE;
+#endif  // HAVE_SQLITE
+    }
+
+
+/*  function        void store_set_meter( store * st, const char * meter )
+
+    brief           Sets the meter the following records come from.
+
+    param[in]       store * st, the store
+    param[in]       const char * meter, serial number of the meter
+*/
+void store_set_meter( store * st, const char * meter )
+    {
+    strncpy(st->meter, meter, STORE_METER_LEN - 1);
+    st->meter[STORE_METER_LEN - 1] = 0;
+    }
+
+
+/*  function        int store_add( store * st, const dataset * data )
+
+    brief           Stores a record. A record already stored is ignored.
+                    Commits every STORE_BATCH records.
+
+    param[in]       store * st, the store
+    param[in]       const dataset * data, the record
+
+    return          int, error code
+*/
+int store_add( store * st, const dataset * data )
+    {
+#ifdef HAVE_SQLITE
+    int result;
+
+    sqlite3_bind_text(st->insert, 1, st->meter, -1, SQLITE_STATIC);
+    sqlite3_bind_int64(st->insert, 2, data->time_key);
+    sqlite3_bind_text(st->insert, 3, data->UTID, -1, SQLITE_STATIC);
+    sqlite3_bind_int(st->insert, 4, data->result);
+    sqlite3_bind_text(st->insert, 5, data->unit, -1, SQLITE_STATIC);
+    sqlite3_bind_text(st->insert, 6, data->flags, -1, SQLITE_STATIC);
+    sqlite3_bind_int(st->insert, 7, data->record_number);
+    result = sqlite3_step(st->insert);
+    sqlite3_reset(st->insert);
+    if( result != SQLITE_DONE )
+        {
+        debug("SQLite : %s\n", sqlite3_errmsg(st->db));
+        return ERR_STORE;
+        }
+
+    if( ++st->pending >= STORE_BATCH )
+        {
+        st->pending = 0;
+        return _exec(st, "COMMIT; BEGIN;");
+        }
+
+    return NOERR;
+#else
+    (void)st;
+    (void)data;
+    return ERR_NO_SQLITE;
+#endif  // HAVE_SQLITE
+    }
+
+
+/*  function        int store_close( store * st, int commit )
+
+    brief           Commits or rolls back the open transaction and closes
+                    the store. Batches committed before are kept.
+
+    param[in]       store * st, the store
+    param[in]       int commit, TRUE : commit, FALSE : roll back
+
+    return          int, error code
+*/
+int store_close( store * st, int commit )
+    {
+    int result = NOERR;
+
+#ifdef HAVE_SQLITE
+    if( st->db == 0 )
+        return NOERR;
+    result = _exec(st, commit ? "COMMIT;" : "ROLLBACK;");
+    sqlite3_finalize(st->insert);
+    if( sqlite3_close(st->db) != SQLITE_OK )
+        result = ERR_STORE;
+    st->db = 0;
+#else
+    (void)commit;
+#endif  // HAVE_SQLITE
+
+    return result;
+    }
@@ -0,0 +1,305 @@
+/*
+    Copyright (C)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+    See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.
+    If not, see <http://www.gnu.org/licenses/>.
+
+    Klabautermann Software
+    Uwe Jantzen
+    Weingartener Straße 33
+    76297 Stutensee
+    Germany
+
+    file        timeindex.c
+
+    date        19.10.2026
+
+    author      Uwe Jantzen (jantzen@klabautermann-software.de)
+
+    brief       Sparse time index of a data file
+
+    details     The index of a data file sorted by time is kept next to
+                it in <file>.tix and tells the offset of the first line of
+                every day, so a date range is read by seeking to its first
+                day. It also tells how much of the data file is indexed,
+                and the offset and time of the last line indexed, so lines
+                appended later are indexed without reading the file again.
+
+    project     glucotux
+    target      Linux
+    begin       03.03.2012
+
+    note
+
+    todo
+
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include "errors.h"
+#include "debug.h"
+#include "globals.h"
+#include "timeindex.h"
+
+
+#define KEY_PER_DAY                         1000000LL                           // hhmmss of a time key
+
+
+typedef struct time_index_header_t
+    {
+    char magic[8];
+    uint64_t covered;
+    uint64_t last_offset;
+    int64_t last_key;
+    uint64_t count;
+    uint32_t sorted;
+    uint32_t reserved;
+    } time_index_header;
+
+
+/*  function        void time_index_init( time_index * idx )
+
+    brief           Makes an empty index of an empty file.
+
+    param[out]      time_index * idx, the index
+*/
+void time_index_init( time_index * idx )
+    {
+    memset(idx, 0, sizeof(time_index));
+    idx->sorted = TRUE;
+    }
+
+
+/*  function        void time_index_free( time_index * idx )
+
+    brief           Frees the index's entries and makes it empty.
+
+    param[in/out]   time_index * idx, the index
+*/
+void time_index_free( time_index * idx )
+    {
+    free(idx->entries);
+    time_index_init(idx);
+    }
+
+
+/*  function        static int _index_name( const char * data_name, char * name, size_t len )
+
+    brief           Gives the name of the index of a data file.
+
+    param[in]       const char * data_name, the data file's name
+    param[out]      char * name, the index's name
+    param[in]       size_t len, size of name
+
+    return          int, error code
+*/
+static int _index_name( const char * data_name, char * name, size_t len )
+    {
+    if( (size_t)snprintf(name, len, "%s%s", data_name, TIME_INDEX_SUFFIX) >= len )
+        return ERR_FILE_NAME_LENGTH;
+
+    return NOERR;
+    }
+
+
+/*  function        int time_index_load( time_index * idx, const char * data_name )
+
+    brief           Reads the index of a data file. If there is none, or it
+                    is not valid, the index is empty. An index is not valid
+                    if its count of entries doesn't fit its size.
+
+    param[out]      time_index * idx, the index
+    param[in]       const char * data_name, the data file's name
+
+    return          int, error code
+*/
+int time_index_load( time_index * idx, const char * data_name )
+    {
+    char name[FILENAME_MAX];
+    time_index_header header;
+    struct stat st;
+    FILE * f;
+    int result;
+
+    time_index_init(idx);
+    result = _index_name(data_name, name, sizeof(name));
+    if( result )
+        return result;
+    f = fopen(name, "r");
+    if( f == 0 )
+        return ( errno == ENOENT ) ? NOERR : errno;
+
+    if( ( fread(&header, sizeof(header), 1, f) != 1 )
+        || ( memcmp(header.magic, TIME_INDEX_MAGIC, sizeof(TIME_INDEX_MAGIC)) != 0 )
+        || ( fstat(fileno(f), &st) != 0 )
+        || ( header.count > ( (uint64_t)st.st_size - sizeof(header) ) / sizeof(time_index_entry) ) )
+        {
+        debug("%s is not valid\n", name);
+        fclose(f);
+        return NOERR;
+        }
+    idx->entries = (time_index_entry *)malloc(( header.count + 1 ) * sizeof(time_index_entry));
+    if( idx->entries == 0 )
+        {
+        fclose(f);
+        return ERR_NOT_ENOUGH_MEMORY;
+        }
+    if( fread(idx->entries, sizeof(time_index_entry), header.count, f) != header.count )
+        {
+        debug("%s is cut short\n", name);
+        fclose(f);
+        time_index_free(idx);
+        return NOERR;
+        }
+    fclose(f);
+
+    idx->covered = header.covered;
+    idx->last_offset = header.last_offset;
+    idx->last_key = header.last_key;
+    idx->sorted = (int)header.sorted;
+    idx->count = header.count;
+    idx->capacity = header.count + 1;
+
+    return NOERR;
+    }
+
+
+/*  function        int time_index_save( const time_index * idx, const char * data_name )
+
+    brief           Writes the index of a data file, first under a temporary
+                    name, then renamed, so it is never found half written.
+
+    param[in]       const time_index * idx, the index
+    param[in]       const char * data_name, the data file's name
+
+    return          int, error code
+*/
+int time_index_save( const time_index * idx, const char * data_name )
+    {
+    char name[FILENAME_MAX];
+    char temporary[FILENAME_MAX];
+    time_index_header header;
+    FILE * f;
+    int result;
+
+    result = _index_name(data_name, name, sizeof(name));
+    if( result )
+        return result;
+    if( (size_t)snprintf(temporary, sizeof(temporary), "%s.new", name) >= sizeof(temporary) )
+        return ERR_FILE_NAME_LENGTH;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TIME_INDEX_MAGIC, sizeof(TIME_INDEX_MAGIC));
+    header.covered = idx->covered;
+    header.last_offset = idx->last_offset;
+    header.last_key = idx->last_key;
+    header.count = idx->count;
+    header.sorted = (uint32_t)idx->sorted;
+
+    f = fopen(temporary, "w");
+    if( f == 0 )
+        return errno;
+    if( ( fwrite(&header, sizeof(header), 1, f) != 1 )
+        || ( fwrite(idx->entries, sizeof(time_index_entry), idx->count, f) != idx->count ) )
+        result = ERR_WRITE_TO_FILE;
+    if( ( fclose(f) != 0 ) && ( result == NOERR ) )
+        result = ERR_WRITE_TO_FILE;
+    if( ( result == NOERR ) && ( rename(temporary, name) != 0 ) )
+        result = errno;
+    if( result )
+        remove(temporary);
+
+    return result;
+    }
+
+
+/*  function        int time_index_add( time_index * idx, long long key, uint64_t offset )
+
+    brief           Adds the next line of the data file. An entry is made
+                    if the line starts a new day. A line older than the one
+                    before marks the file as not sorted.
+
+    param[in/out]   time_index * idx, the index
+    param[in]       long long key, the line's time key
+    param[in]       uint64_t offset, the line's offset
+
+    return          int, error code
+*/
+int time_index_add( time_index * idx, long long key, uint64_t offset )
+    {
+    time_index_entry * entries;
+    size_t capacity;
+    long long day = key / KEY_PER_DAY;
+
+    if( key < idx->last_key )
+        {
+        idx->sorted = FALSE;
+        return NOERR;
+        }
+    if( ( idx->count == 0 ) || ( idx->entries[idx->count - 1].day != day ) )
+        {
+        if( idx->count == idx->capacity )
+            {
+            capacity = idx->capacity ? 2 * idx->capacity : 512;
+            entries = (time_index_entry *)realloc(idx->entries, capacity * sizeof(time_index_entry));
+            if( entries == 0 )
+                return ERR_NOT_ENOUGH_MEMORY;
+            idx->entries = entries;
+            idx->capacity = capacity;
+            }
+        idx->entries[idx->count].day = day;
+        idx->entries[idx->count].offset = offset;
+        ++idx->count;
+        }
+    idx->last_key = key;
+    idx->last_offset = offset;
+
+    return NOERR;
+    }
+
+
+/*  function        uint64_t time_index_find( const time_index * idx, long long from )
+
+    brief           Finds where to start reading records from time <from> on :
+                    the first line of the first day not before the day of
+                    <from>. All lines before it are older than <from>.
+
+    param[in]       const time_index * idx, the index
+    param[in]       long long from, the time key
+
+    return          uint64_t, offset in the data file
+*/
+uint64_t time_index_find( const time_index * idx, long long from )
+    {
+    long long day = from / KEY_PER_DAY;
+    size_t low = 0;
+    size_t high = idx->count;
+    size_t middle;
+
+    while( low < high )
+        {
+        middle = low + ( high - low ) / 2;
+        if( idx->entries[middle].day < day )
+            low = middle + 1;
+        else
+            high = middle;
+        }
+
+    return ( low < idx->count ) ? idx->entries[low].offset : idx->covered;
+    }
@@ -49,6 +49,7 @@
 #include "globals.h"
 #include "errors.h"
 #include "debug.h"
+#include "format.h"
 #include "utils.h"
 
 
@@ -126,27 +127,18 @@ unsigned int explode( char * elements, char * str, char delimiter, size_t lines,
 int printline( dataset * data, FILE * f )
     {
     int error = NOERR;
-    char value[16];
-    char buffer[128];
+    char buffer[FORMAT_LINE_LEN];
+    size_t len;
 
-    if( ( *(data->UTID) == 'I' ) || ( *(data->UTID) == 'W' ) )
-        snprintf(value, 16, "%3d.%d", data->result/10, data->result%10);
-    else
-        snprintf(value, 16, "%5d", data->result);
-    snprintf(buffer, 128, "%-14s  %5s  %-6s  %-9s  %-8s  %c  %4d\n",
-            data->timestamp,
-            value,
-            data->unit,
-            data->flags,
-            data->UTID,
-            data->record_type,
-            data->record_number);
+    len = format_line(data, buffer);
 
     debug("printline : ");
-    if( is_verbose() || is_debug() )
+    if( f == 0 )                                                                // no output file given
+        f = stdout;
+    else if( is_verbose() || is_debug() )
         printf("%s", buffer);
 
-    if( fprintf(f, "%s", buffer) < 0 )
+    if( fwrite(buffer, 1, len, f) != len )
         error = ERR_WRITE_TO_FILE;
 
     return error;
@@ -190,20 +182,98 @@ void time2ger( char * dst, char * src )
     }
 
 
-/*  function        void rotating_bar( void )
+/*  function        long long timestamp_key( const char * timestamp )
+
+    brief           Converts a timestamp YYYYMMDDhhmm or YYYYMMDDhhmmss to
+                    the number YYYYMMDDhhmmss, seconds default to 0. Keys of
+                    all meter models sort by time.
 
-    brief           Rotates a bar at cursor position showing the application is
-                    still working.
+    param[in]       const char * timestamp, the record's timestamp
+
+    return          long long, the timestamp as a number
 */
-void rotating_bar( void )
+long long timestamp_key( const char * timestamp )
     {
-    char const bars[] = { '-', '\\', '|', '/' };
-    static int idx = 0;
+    long long key = 0;
+    int i;
+
+    for( i = 0; ( i < 14 ) && ( timestamp[i] >= '0' ) && ( timestamp[i] <= '9' ); ++i )
+        key = key * 10 + (timestamp[i] - '0');
+    for( ; i < 14; ++i )                                                        // no seconds
+        key *= 10;
+
+    return key;
+    }
+
+
+/*  function        int date_key( const char * date, int until, long long * key )
+
+    brief           Converts a date YYYY[MM[DD[hh[mm[ss]]]]] to a time key.
+                    The digits left out are 0 for the start of a range and
+                    9 for its end, so 2019 is from the first to the last
+                    record of the year.
+
+    param[in]       const char * date, the date
+    param[in]       int until, TRUE for the end of a range
+    param[out]      long long * key, the time key
+
+    return          int, error code
+*/
+int date_key( const char * date, int until, long long * key )
+    {
+    size_t len = strlen(date);
+    long long k = 0;
+    size_t i;
+
+    if( ( len < 4 ) || ( len > 14 ) || ( len & 1 ) || ( strspn(date, "0123456789") != len ) )
+        return ERR_DATE_FORMAT;
+
+    for( i = 0; i < 14; ++i )
+        k = k * 10 + ( ( i < len ) ? date[i] - '0' : ( until ? 9 : 0 ) );
+    *key = k;
+
+    return NOERR;
+    }
+
+
+/*  function        void key_timestamp( char * timestamp, long long key, int digits )
+
+    brief           Converts a key YYYYMMDDhhmmss back to the timestamp it
+                    was made from, the first <digits> digits are used.
+
+    param[out]      char * timestamp, the timestamp, at least digits + 1 chars
+    param[in]       long long key, the timestamp as a number
+    param[in]       int digits, number of digits of the timestamp, 12 or 14
+*/
+void key_timestamp( char * timestamp, long long key, int digits )
+    {
+    int i;
+
+    timestamp[digits] = 0;
+    for( i = 13; i >= 0; --i, key /= 10 )
+        {
+        if( i < digits )
+            timestamp[i] = (char)('0' + key % 10);
+        }
+    }
+
+
+/*  function        double seconds_since( const struct timespec * start )
+
+    brief           Returns the time elapsed since <start> was read from the
+                    monotonic clock.
+
+    param[in]       const struct timespec * start, start time
+
+    return          double, elapsed time in seconds
+*/
+double seconds_since( const struct timespec * start )
+    {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
 
-    putc(BS, stdout);
-    putc(bars[idx++], stdout);
-    fflush(stdout);
-    idx &= 0x03;
+    return (double)(now.tv_sec - start->tv_sec) + (double)(now.tv_nsec - start->tv_nsec) / 1e9;
     }
 
 
@@ -216,31 +286,74 @@ void rotating_bar( void )
 void showhelp( char * name )
     {
     printf("Usage:\n");
-#ifdef NIX
-    printf("        %s [options] [-o <outfile> [-i <infile> [-i|-r <infile>]]]\n", name);
-#else
-    printf("        %s [options] [-o <outfile> [-i <infile> [-i <infile>]]]\n", name);
-#endif
+    printf("        %s [options] [-o <outfile> [-i <infile> [-i <infile> ...]] | [-r <infile>]]\n", name);
     printf("Options:\n");
     printf("        -o <outfile>  File to put the data in,\n");
     printf("                      if not set, data is printed to screen\n");
-    printf("        -i <infile>   File to get the data from,\n");
+    printf("                      <outfile>.gz or <outfile>.zst is written compressed,\n");
+    printf("                      compressed <infile>s are recognized when read\n");
+    printf("                      <outfile>.gtx is written in the binary column format,\n");
+    printf("                      faster to read again than any text file\n");
+    printf("        -i <infile>   File to get the data from, a directory or a quoted pattern\n");
+    printf("                      like \"dumps/*.txt\" gives all files in it,\n");
     printf("                      if set, data is read from <infile> and sorted into <outfile>\n");
-    printf("                      removing duplicate lines.\n");
+    printf("                      removing duplicate records.\n");
     printf("                      <outfile> and <infile> must NOT BE THE SAME!\n");
     printf("        -c            If this option is selected the application reads the data\n");
     printf("                      from <infile> and writes it to <outfile> using CVS format as\n");
     printf("                      follows:\n");
     printf("                      date|time|glucose|glucose unit|insulin|insulin type|carb|carb unit|user mark\n");
-#ifdef NIX
+    printf("        -j            Write JSON lines, one object per record, instead of the data\n");
+    printf("                      file format, when downloading or when reading from <infile> :\n");
+    printf("                      {\"time\":<seconds since 1970>,\"value\":<number>,\"unit\":\"..\",\n");
+    printf("                       \"flags\":\"..\",\"type\":\"..\",\"record\":<number>}\n");
     printf("        -r <infile>   If this option is selected the application reads the data\n");
-    printf("                      from <infile> using the data order that was implemented\n");
+    printf("                      from <infile>, e.g. using the data order that was implemented\n");
     printf("                      before 30.3.2018. Then it writes back the data to <outfile>\n");
     printf("                      using the current data order.\n");
-#endif
+    printf("                      The data order of every <infile> is recognized by itself.\n");
+    printf("        -n            Download new records only and append them to <outfile>.\n");
+    printf("                      The newest record read is kept per meter in\n");
+    printf("                      $HOME/.glucotux/<serial>.hwm, no filter may be set\n");
+    printf("        -s <capture>  Save the raw data read from the meter to <capture>\n");
+    printf("        -x <capture>  Decode the raw data saved to <capture> instead of reading\n");
+    printf("                      from the meter, output is the same as for a live download\n");
+    printf("        -q <database> Store the records in the SQLite <database> too, records\n");
+    printf("                      already stored are skipped. With <infile>s given the\n");
+    printf("                      records put out are stored too, for the meter -e <serial>.\n");
+    printf("                      (only if built with make sqlite=1)\n");
+    printf("        -e <serial>   Serial number of the meter the <infile>s come from\n");
+    printf("        -a <master>   Append the records of the <infile>s to the master history in\n");
+    printf("                      the directory <master>, only those not in it yet. Without\n");
+    printf("                      <infile>s the whole history is put out to <outfile>.\n");
+    printf("        -f <date>     Put out only the records from <date> on and\n");
+    printf("        -u <date>     up to <date>, given as YYYY[MM[DD[hh[mm[ss]]]]], e.g.\n");
+    printf("                      -f 201901 -u 201903 for January to March 2019.\n");
+    printf("                      A sorted <infile> is read from the range's first day\n");
+    printf("                      on, found by an index the range writes next to it as\n");
+    printf("                      <infile>.tix. A directory or pattern given by -i skips\n");
+    printf("                      these files\n");
+    printf("        -y <types>    Put out only records of <types>, e.g. Glucose or Carb,Insulin\n");
+    printf("        -k <markers>  Put out only records with one of the meal <markers> B (before\n");
+    printf("                      meal), A (after meal), F (fasting), N (none), O (other)\n");
+    printf("        -w <min>:<max> Put out only records with values from <min> to <max>, one\n");
+    printf("                      may be left out, insulin in tenths of units, e.g. -w 70:180\n");
+    printf("                      Filters (-f, -u, -y, -k, -w) are checked while reading, from\n");
+    printf("                      the meter as well as from <infile>s\n");
+    printf("        -m <MB>       Sort <infile>s in runs of at most <MB> megabytes of memory,\n");
+    printf("                      runs are kept in temporary files and merged\n");
+    printf("        -t <threads>  Read <infile>s with <threads> threads, default is one per\n");
+    printf("                      processor\n");
+    printf("        -p <fd>       Write the progress of a download as JSON lines to the file\n");
+    printf("                      descriptor <fd>, e.g. -p 3 3>progress.log\n");
     printf("\n");
-    printf("           If you give two <infile>s they are mixed and put out to <outfile> (not implemented yet!).\n");
+    printf("           If you give more than one <infile> they are mixed and put out to <outfile>\n");
+    printf("           sorted by time without duplicate records, using the format selected.\n");
+    printf("           The files are read and merged by -t <threads> threads in memory, with\n");
+    printf("           -m <MB> or if they are too large for memory they are read one\n");
+    printf("           record at a time.\n");
     printf("\n");
+    printf("        -b            Run the built-in benchmarks then stop\n");
     printf("        -v            Enable verbose mode\n");
 #ifdef _DEBUG_
     printf("        -d            Enable debug mode\n");